@@ -0,0 +1,74 @@
+#!/bin/sh
+# Entrenamiento de PGO (objetivo pgo-train, con IAM_PGO=GENERATE): ejecuta los
+# binarios instrumentados con el corpus de la prueba de carga (preguntas del
+# dataset y paráfrasis) para que el perfil refleje el tráfico real.
+#   - chatbot_ia (si se compiló): atiende load_test por HTTP durante
+#     IAM_PGO_SECONDS segundos con el Ollama simulado de load_test.
+#   - ollama_client: responde IAM_PGO_QUESTIONS preguntas del mismo corpus.
+# Todo corre en un directorio temporal con su propia instantánea y bases de
+# datos, así que no toca el repositorio.
+
+set -e
+
+: "${IAM_SOURCE_DIR:?}" "${IAM_BINARY_DIR:?}" "${IAM_PGO_DIR:?}"
+SECONDS_TO_RUN="${IAM_PGO_SECONDS:-20}"
+QUESTIONS="${IAM_PGO_QUESTIONS:-200}"
+MOCK_PORT="${IAM_PGO_MOCK_PORT:-11500}"
+DATASET="$IAM_SOURCE_DIR/dataset/nolivos_immigration_ai_extended.json"
+
+WORK_DIR="$(mktemp -d)"
+SERVER_PID=""
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill -INT "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT INT TERM
+
+# Los programas buscan ../dataset/kb.snapshot desde su directorio de trabajo
+mkdir -p "$WORK_DIR/dataset" "$WORK_DIR/run" "$IAM_PGO_DIR"
+"$IAM_BINARY_DIR/kb_compile" --complex-cases "$WORK_DIR/dataset/kb.snapshot" "$DATASET" > /dev/null
+cd "$WORK_DIR/run"
+
+if [ -x "$IAM_BINARY_DIR/chatbot_ia" ]; then
+    echo "PGO: entrenando chatbot_ia durante $SECONDS_TO_RUN s"
+    OLLAMA_URL="http://127.0.0.1:$MOCK_PORT/api/generate" LOG_LEVEL=error \
+        "$IAM_BINARY_DIR/chatbot_ia" > server.log 2>&1 &
+    SERVER_PID=$!
+
+    tries=0
+    until curl -s -o /dev/null http://127.0.0.1:8080/health; do
+        tries=$((tries + 1))
+        if [ "$tries" -gt 100 ] || ! kill -0 "$SERVER_PID" 2>/dev/null; then
+            echo "PGO: el servidor no arrancó" >&2
+            cat server.log >&2
+            exit 1
+        fi
+        sleep 0.1
+    done
+
+    "$IAM_BINARY_DIR/load_test" --url http://127.0.0.1:8080 --mock-ollama "$MOCK_PORT" \
+        --mock-first-token-ms 5 --mock-token-ms 1 --concurrency 8 --warmup 0 --duration "$SECONDS_TO_RUN" \
+        "$DATASET"
+
+    # El perfil se escribe al salir: terminar de forma ordenada
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID" || true
+    SERVER_PID=""
+fi
+
+echo "PGO: entrenando ollama_client con $QUESTIONS preguntas"
+"$IAM_BINARY_DIR/load_test" --print-questions "$QUESTIONS" "$DATASET" > questions.txt
+while IFS= read -r question; do
+    OLLAMA_URL="http://127.0.0.1:9/api/generate" LOG_LEVEL=error \
+        "$IAM_BINARY_DIR/ollama_client" "$question" > /dev/null 2>&1 || true
+done < questions.txt
+
+# Clang escribe perfiles en bruto que hay que fusionar
+if [ "$IAM_CXX_COMPILER_ID" != "GNU" ]; then
+    llvm-profdata merge -output="$IAM_PGO_DIR/default.profdata" "$IAM_PGO_DIR"/*.profraw
+fi
+
+echo "PGO: perfiles en $IAM_PGO_DIR; reconfigurar con -DIAM_PGO=USE y recompilar"
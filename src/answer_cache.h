@@ -0,0 +1,165 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+// Métricas de la caché de respuestas
+struct CacheStats {
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t capacity_bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+};
+
+// Caché LRU con caducidad (TTL) dividida en fragmentos. Cada fragmento tiene
+// su propio mutex, lista LRU y tabla hash, así que get/put/evict son O(1) y
+// las peticiones concurrentes solo compiten si caen en el mismo fragmento.
+// La capacidad se expresa en bytes (clave + respuesta + sobrecarga).
+class ShardedLruCache {
+public:
+    explicit ShardedLruCache(size_t capacity_bytes = 64 * 1024 * 1024,
+                             std::chrono::seconds ttl = std::chrono::seconds(3600),
+                             size_t shard_count = 16)
+        : shards_(shard_count == 0 ? 1 : shard_count),
+          capacity_bytes_(capacity_bytes),
+          shard_capacity_(capacity_bytes / shards_.size()),
+          ttl_(ttl) {}
+
+    ShardedLruCache(const ShardedLruCache&) = delete;
+    ShardedLruCache& operator=(const ShardedLruCache&) = delete;
+
+    // Clave compuesta por la pregunta normalizada y el idioma
+    static std::string make_key(const std::string& normalized_question, const std::string& language) {
+        std::string key;
+        key.reserve(language.size() + 1 + normalized_question.size());
+        key.append(language).push_back('\x1f');
+        key.append(normalized_question);
+        return key;
+    }
+
+    // Respuesta cacheada o cadena vacía si no existe o ha caducado
+    std::string get(const std::string& key) {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            misses_++;
+            return "";
+        }
+
+        auto node = it->second;
+        if (std::chrono::steady_clock::now() >= node->expires) {
+            shard.bytes -= node->bytes;
+            shard.index.erase(it);
+            shard.lru.erase(node);
+            expirations_++;
+            misses_++;
+            return "";
+        }
+
+        // Mover al frente (más reciente) sin copiar
+        shard.lru.splice(shard.lru.begin(), shard.lru, node);
+        hits_++;
+        return node->value;
+    }
+
+    void put(const std::string& key, const std::string& value) {
+        const size_t bytes = key.size() + value.size() + ENTRY_OVERHEAD;
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            auto node = it->second;
+            shard.bytes -= node->bytes;
+            shard.index.erase(it);
+            shard.lru.erase(node);
+        }
+
+        if (bytes > shard_capacity_) {
+            return;
+        }
+
+        // Desalojar desde el final (menos reciente) hasta que quepa
+        while (!shard.lru.empty() && shard.bytes + bytes > shard_capacity_) {
+            auto& oldest = shard.lru.back();
+            shard.bytes -= oldest.bytes;
+            shard.index.erase(std::string_view(oldest.key));
+            shard.lru.pop_back();
+            evictions_++;
+        }
+
+        shard.lru.push_front({key, value, std::chrono::steady_clock::now() + ttl_, bytes});
+        shard.index.emplace(std::string_view(shard.lru.front().key), shard.lru.begin());
+        shard.bytes += bytes;
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.index.clear();
+            shard.lru.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    CacheStats stats() const {
+        CacheStats stats;
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            stats.entries += shard.lru.size();
+            stats.bytes += shard.bytes;
+        }
+        stats.capacity_bytes = capacity_bytes_;
+        stats.hits = hits_.load();
+        stats.misses = misses_.load();
+        stats.evictions = evictions_.load();
+        stats.expirations = expirations_.load();
+        return stats;
+    }
+
+private:
+    // Sobrecarga aproximada por entrada (nodo de lista + cubeta de la tabla)
+    static constexpr size_t ENTRY_OVERHEAD = 96;
+
+    struct Entry {
+        std::string key;
+        std::string value;
+        std::chrono::steady_clock::time_point expires;
+        size_t bytes;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;
+        // Las claves apuntan al std::string del nodo, que no se mueve
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    Shard& shard_for(const std::string& key) {
+        return shards_[std::hash<std::string>{}(key) % shards_.size()];
+    }
+
+    std::vector<Shard> shards_;
+    const size_t capacity_bytes_;
+    const size_t shard_capacity_;
+    const std::chrono::seconds ttl_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> expirations_{0};
+};
@@ -0,0 +1,96 @@
+// Pruebas de ShardedLruCache (answer_cache.h). Se ejecuta con ctest.
+// Al llenarse se desaloja la entrada usada hace más tiempo, las respuestas
+// caducan al cumplirse el TTL y los bytes nunca superan la capacidad.
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include "answer_cache.h"
+
+static size_t g_checks = 0;
+static size_t g_failures = 0;
+
+static void expect(bool condition, const std::string& what) {
+    g_checks++;
+    if (!condition) {
+        g_failures++;
+        std::cerr << "FALLO: " << what << "\n";
+    }
+}
+
+int main() {
+    // Con un solo fragmento el orden LRU es global. Cada entrada ocupa
+    // clave (2) + respuesta (10) + sobrecarga (96) = 108 bytes: caben tres.
+    const std::string answer = "respuesta.";
+    const size_t entry_bytes = 2 + answer.size() + 96;
+    {
+        ShardedLruCache cache(3 * entry_bytes, std::chrono::seconds(3600), 1);
+        cache.put("k1", answer);
+        cache.put("k2", answer);
+        cache.put("k3", answer);
+        expect(cache.stats().entries == 3 && cache.stats().bytes == 3 * entry_bytes, "caben tres entradas");
+
+        // k1 pasa a ser la más reciente; la siguiente inserción desaloja k2
+        expect(cache.get("k1") == answer, "acierto antes de llenarse");
+        cache.put("k4", answer);
+        expect(cache.get("k2").empty(), "se desaloja la usada hace más tiempo");
+        expect(cache.get("k1") == answer && cache.get("k3") == answer && cache.get("k4") == answer,
+               "las recientes siguen en la caché");
+        CacheStats stats = cache.stats();
+        expect(stats.evictions == 1 && stats.entries == 3 && stats.bytes == 3 * entry_bytes, "un desalojo");
+        expect(stats.hits == 4 && stats.misses == 1, "aciertos y fallos");
+
+        // Reemplazar una clave no desaloja nada y guarda la respuesta nueva
+        cache.put("k3", "nueva.....");
+        expect(cache.get("k3") == "nueva....." && cache.stats().evictions == 1, "reemplazo sin desalojo");
+
+        // Una respuesta mayor que el fragmento no se guarda ni desaloja otras
+        cache.put("k5", std::string(4 * entry_bytes, 'x'));
+        expect(cache.get("k5").empty() && cache.stats().entries == 3 && cache.stats().evictions == 1,
+               "respuesta demasiado grande");
+
+        // Reemplazar por una respuesta que no cabe elimina la anterior
+        cache.put("k4", std::string(4 * entry_bytes, 'x'));
+        expect(cache.get("k4").empty() && cache.stats().entries == 2, "reemplazo demasiado grande");
+
+        cache.clear();
+        expect(cache.stats().entries == 0 && cache.stats().bytes == 0 && cache.get("k1").empty(), "clear");
+    }
+
+    // Con varios fragmentos los bytes nunca superan la capacidad total
+    {
+        ShardedLruCache cache(16 * 1024, std::chrono::seconds(3600), 4);
+        for (int i = 0; i < 1000; ++i) {
+            cache.put(ShardedLruCache::make_key("pregunta " + std::to_string(i), "es"), answer);
+        }
+        CacheStats stats = cache.stats();
+        expect(stats.bytes <= stats.capacity_bytes && stats.entries > 0, "capacidad total respetada");
+        expect(stats.evictions == 1000 - stats.entries, "cada entrada que falta se desalojó");
+        expect(cache.get(ShardedLruCache::make_key("pregunta 999", "es")) == answer, "la última sigue en la caché");
+        expect(cache.get(ShardedLruCache::make_key("pregunta 999", "en")).empty(), "la clave incluye el idioma");
+    }
+
+    // Caducidad: con TTL 0 nada sobrevive; con TTL 1 s, hasta que pasa el segundo
+    {
+        ShardedLruCache cache(1024 * 1024, std::chrono::seconds(0), 1);
+        cache.put("k1", answer);
+        expect(cache.get("k1").empty(), "TTL 0 caduca al momento");
+        CacheStats stats = cache.stats();
+        expect(stats.expirations == 1 && stats.entries == 0 && stats.bytes == 0, "la caducada se elimina");
+    }
+    {
+        ShardedLruCache cache(1024 * 1024, std::chrono::seconds(1), 1);
+        cache.put("k1", answer);
+        expect(cache.get("k1") == answer, "vigente antes del TTL");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        expect(cache.get("k1").empty(), "caducada después del TTL");
+        expect(cache.stats().expirations == 1 && cache.stats().entries == 0, "se cuenta la caducidad");
+
+        // Volver a guardarla reinicia el plazo
+        cache.put("k1", answer);
+        expect(cache.get("k1") == answer, "vigente al volver a guardarla");
+    }
+
+    std::cout << "answer_cache: " << g_checks << " comprobaciones, " << g_failures << " fallos\n";
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "logging.h"
+
+// Modo demonio del cliente de línea de comandos: un proceso mantiene el
+// Engine cargado detrás de un socket Unix y cada ejecución de ollama_client
+// solo le reenvía la pregunta. El protocolo es mínimo: el cliente escribe la
+// pregunta y cierra su mitad de escritura; el demonio responde con el texto
+// de la respuesta y cierra la conexión. Sin respuesta significa error.
+
+// IA_MIGRANTE_SOCKET o, por defecto, un socket en $XDG_RUNTIME_DIR (privado
+// del usuario). Sin él, dentro de un directorio propio en /tmp que el demonio
+// crea con permisos 0700; un nombre fijo directamente en /tmp lo podría
+// ocupar antes otro usuario.
+inline std::string default_daemon_socket_path() {
+    if (const char* env = std::getenv("IA_MIGRANTE_SOCKET")) {
+        return env;
+    }
+    if (const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR"); runtime_dir && *runtime_dir) {
+        return std::string(runtime_dir) + "/ia_migrante.sock";
+    }
+    return "/tmp/ia_migrante-" + std::to_string(::getuid()) + "/daemon.sock";
+}
+
+namespace cli_daemon_detail {
+
+// Preguntas más largas se rechazan sin leerlas enteras
+constexpr size_t MAX_QUESTION_BYTES = 64 * 1024;
+
+inline bool make_address(const std::string& path, sockaddr_un& addr) {
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        log_error("Ruta de socket no válida: " + path);
+        return false;
+    }
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+inline bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Lee hasta que el otro extremo cierre; false si falla o pasa de max_bytes
+inline bool receive_all(int fd, std::string& data, size_t max_bytes) {
+    char chunk[16 * 1024];
+    while (true) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n == 0) {
+            return true;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (data.size() + static_cast<size_t>(n) > max_bytes) {
+            return false;
+        }
+        data.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+// El otro extremo del socket es un proceso del mismo usuario
+inline bool peer_is_same_user(int fd) {
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+        return false;
+    }
+    return credentials.uid == ::getuid();
+}
+
+} // namespace cli_daemon_detail
+
+// El directorio del socket debe ser nuestro y no escribible por otros (si no
+// existe se crea con 0700); si no, otro usuario podría sustituir el socket
+inline bool ensure_private_socket_directory(const std::string& socket_path) {
+    const size_t slash = socket_path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : socket_path.substr(0, slash);
+    if (::mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        log_error("Demonio: no se pudo crear " + directory + ": " + std::strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (::lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        log_error("Demonio: " + directory + " no es un directorio");
+        return false;
+    }
+    if (info.st_uid != ::getuid() || (info.st_mode & 022) != 0) {
+        log_error("Demonio: " + directory + " no pertenece al usuario o lo pueden modificar otros; "
+                  "use --socket o IA_MIGRANTE_SOCKET en un directorio privado");
+        return false;
+    }
+    return true;
+}
+
+// Preguntar al demonio. false si no hay ninguno escuchando en socket_path (el
+// llamador responde entonces por sí mismo), si la conexión falla o si quien
+// escucha es otro usuario: su respuesta no se mostraría como propia.
+inline bool ask_daemon(const std::string& socket_path, const std::string& question, std::string& answer) {
+    sockaddr_un addr;
+    if (!cli_daemon_detail::make_address(socket_path, addr)) {
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (!cli_daemon_detail::peer_is_same_user(fd)) {
+        log_error("El socket " + socket_path + " pertenece a otro usuario; se ignora");
+        ::close(fd);
+        return false;
+    }
+    bool ok = cli_daemon_detail::send_all(fd, question) &&
+              ::shutdown(fd, SHUT_WR) == 0 &&
+              cli_daemon_detail::receive_all(fd, answer, SIZE_MAX);
+    ::close(fd);
+    return ok && !answer.empty();
+}
+
+// connect() sin enviar nada: distingue un demonio vivo de un socket abandonado
+inline bool daemon_listening(const std::string& socket_path) {
+    sockaddr_un addr;
+    if (!cli_daemon_detail::make_address(socket_path, addr)) {
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    bool listening = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(fd);
+    return listening;
+}
+
+// Servidor del socket. Varios hilos bloquean en accept() sobre el mismo
+// socket y cada uno atiende una conexión de principio a fin, así que hay a lo
+// sumo `workers` preguntas respondiéndose a la vez.
+class AnswerDaemon {
+public:
+    using Handler = std::function<std::string(const std::string& question)>;
+
+    ~AnswerDaemon() { stop(); }
+
+    bool start(const std::string& socket_path, Handler handler, size_t workers = 8) {
+        sockaddr_un addr;
+        if (!cli_daemon_detail::make_address(socket_path, addr) ||
+            !ensure_private_socket_directory(socket_path)) {
+            return false;
+        }
+
+        // Un socket que nadie atiende es de un demonio que terminó mal: se reemplaza
+        if (daemon_listening(socket_path)) {
+            log_error("Ya hay un demonio escuchando en " + socket_path);
+            return false;
+        }
+        ::unlink(socket_path.c_str());
+
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            log_error("Demonio: no se pudo crear el socket: " + std::string(std::strerror(errno)));
+            return false;
+        }
+        // Solo el usuario: las respuestas salen de su base de datos
+        mode_t old_mask = ::umask(077);
+        bool bound = ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        ::umask(old_mask);
+        if (!bound || ::listen(listen_fd_, 128) != 0) {
+            log_error("Demonio: no se pudo escuchar en " + socket_path + ": " + std::strerror(errno));
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+
+        socket_path_ = socket_path;
+        handler_ = std::move(handler);
+        running_ = true;
+        for (size_t i = 0; i < (workers == 0 ? 1 : workers); ++i) {
+            workers_.emplace_back(&AnswerDaemon::accept_loop, this);
+        }
+        log_info("Demonio escuchando en " + socket_path);
+        return true;
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int fd : client_fds_) {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        ::unlink(socket_path_.c_str());
+    }
+
+private:
+    void accept_loop() {
+        while (running_) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (!running_) {
+                    break;
+                }
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                // EMFILE, ENFILE, ENOBUFS...: reintentar enseguida solo gastaría CPU
+                log_error("Demonio: accept falló: " + std::string(std::strerror(errno)));
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            if (!cli_daemon_detail::peer_is_same_user(fd)) {
+                log_error("Demonio: conexión rechazada de otro usuario");
+                ::close(fd);
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                client_fds_.push_back(fd);
+            }
+            serve(fd);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto it = client_fds_.begin(); it != client_fds_.end(); ++it) {
+                    if (*it == fd) {
+                        client_fds_.erase(it);
+                        break;
+                    }
+                }
+            }
+            ::close(fd);
+        }
+    }
+
+    void serve(int fd) {
+        // Un cliente que no termina de escribir no retiene el hilo indefinidamente
+        timeval timeout{5, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::string question;
+        if (!cli_daemon_detail::receive_all(fd, question, cli_daemon_detail::MAX_QUESTION_BYTES)) {
+            log_error("Demonio: pregunta no recibida o demasiado larga");
+            return;
+        }
+        if (question.empty()) {
+            return;
+        }
+
+        LogRequestScope log_scope(log_next_request_id());
+        std::string answer = handler_(question);
+        if (!cli_daemon_detail::send_all(fd, answer)) {
+            log_debug("Demonio: el cliente cerró antes de recibir la respuesta");
+        }
+    }
+
+    std::string socket_path_;
+    Handler handler_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::vector<int> client_fds_;
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+#include <sqlite3.h>
+#include "logging.h"
+
+// Conexión SQLite con caché de sentencias preparadas. Cada sentencia se
+// prepara una sola vez y se reutiliza (reset + clear_bindings) en las
+// siguientes llamadas. Una conexión solo debe usarse desde un hilo a la vez.
+class DatabaseConnection {
+public:
+    explicit DatabaseConnection(sqlite3* db) : db_(db) {}
+
+    ~DatabaseConnection() {
+        for (auto& [sql, stmt] : statements_) {
+            sqlite3_finalize(stmt);
+        }
+        sqlite3_close(db_);
+    }
+
+    DatabaseConnection(const DatabaseConnection&) = delete;
+    DatabaseConnection& operator=(const DatabaseConnection&) = delete;
+
+    sqlite3* handle() const { return db_; }
+
+    // Sentencia preparada lista para enlazar parámetros; nullptr si falla
+    sqlite3_stmt* prepare(const std::string& sql) {
+        auto it = statements_.find(sql);
+        if (it != statements_.end()) {
+            sqlite3_reset(it->second);
+            sqlite3_clear_bindings(it->second);
+            return it->second;
+        }
+
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            return nullptr;
+        }
+
+        statements_.emplace(sql, stmt);
+        return stmt;
+    }
+
+    const char* last_error() const { return sqlite3_errmsg(db_); }
+
+private:
+    sqlite3* db_;
+    std::unordered_map<std::string, sqlite3_stmt*> statements_;
+};
+
+// Libera los parámetros y el cursor de una sentencia cacheada al salir del ámbito
+class StatementReset {
+public:
+    explicit StatementReset(sqlite3_stmt* stmt) : stmt_(stmt) {}
+    ~StatementReset() {
+        if (stmt_) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+        }
+    }
+
+    StatementReset(const StatementReset&) = delete;
+    StatementReset& operator=(const StatementReset&) = delete;
+
+private:
+    sqlite3_stmt* stmt_;
+};
+
+// Acceso a la base de datos en modo WAL: una conexión de lectura por hilo
+// (las lecturas no se bloquean entre sí ni con el escritor) y una única
+// conexión de escritura protegida por un mutex.
+class DatabasePool {
+public:
+    DatabasePool() = default;
+    ~DatabasePool() { close(); }
+
+    DatabasePool(const DatabasePool&) = delete;
+    DatabasePool& operator=(const DatabasePool&) = delete;
+
+    bool open(const std::string& db_path) {
+        close();
+
+        sqlite3* db = open_connection(db_path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        if (!db) {
+            return false;
+        }
+
+        char* errMsg = nullptr;
+        if (sqlite3_exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
+            log_error("No se pudo activar el modo WAL: " + std::string(errMsg ? errMsg : ""));
+            sqlite3_free(errMsg);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        path_ = db_path;
+        writer_ = std::make_unique<DatabaseConnection>(db);
+        generation_.store(next_generation().fetch_add(1) + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Cerrar todas las conexiones; no debe haber consultas en curso
+    void close() {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_.store(0, std::memory_order_release);
+        readers_.clear();
+        writer_.reset();
+    }
+
+    bool is_open() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return writer_ != nullptr;
+    }
+
+    // Conexión de lectura del hilo actual (se crea la primera vez). El
+    // camino habitual no toma ningún lock. Cada hilo guarda una conexión por
+    // pool, así que alternar entre varios pools no reabre conexiones.
+    DatabaseConnection* reader() {
+        thread_local std::vector<ThreadSlot> slots;
+
+        const uint64_t generation = generation_.load(std::memory_order_acquire);
+        if (generation == 0) {
+            return nullptr;
+        }
+        ThreadSlot* slot = nullptr;
+        for (auto& candidate : slots) {
+            if (candidate.pool == this) {
+                slot = &candidate;
+                break;
+            }
+        }
+        if (slot && slot->generation == generation) {
+            return slot->connection;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation_.load(std::memory_order_relaxed) != generation) {
+            return nullptr;
+        }
+
+        sqlite3* db = open_connection(path_, SQLITE_OPEN_READONLY);
+        if (!db) {
+            return nullptr;
+        }
+
+        readers_.push_back(std::make_unique<DatabaseConnection>(db));
+        // La generación es única entre pools: una ranura de un pool destruido
+        // cuya dirección se reutiliza nunca coincide y se sobrescribe aquí
+        if (!slot) {
+            slot = &slots.emplace_back();
+        }
+        *slot = {this, generation, readers_.back().get()};
+        return slot->connection;
+    }
+
+    // Ejecutar una operación con la conexión de escritura (exclusiva)
+    template <typename Fn>
+    void with_writer(Fn&& fn) {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        DatabaseConnection* writer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writer = writer_.get();
+        }
+        if (!writer) {
+            log_error("Base de datos no inicializada");
+            return;
+        }
+        fn(*writer);
+    }
+
+    size_t reader_count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return readers_.size();
+    }
+
+private:
+    struct ThreadSlot {
+        const DatabasePool* pool = nullptr;
+        uint64_t generation = 0;
+        DatabaseConnection* connection = nullptr;
+    };
+
+    static std::atomic<uint64_t>& next_generation() {
+        static std::atomic<uint64_t> generation{0};
+        return generation;
+    }
+
+    static sqlite3* open_connection(const std::string& db_path, int flags) {
+        sqlite3* db = nullptr;
+        if (sqlite3_open_v2(db_path.c_str(), &db, flags | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+            log_error("Error al abrir la base de datos: " + std::string(db ? sqlite3_errmsg(db) : "sin memoria"));
+            sqlite3_close(db);
+            return nullptr;
+        }
+        sqlite3_busy_timeout(db, 5000);
+        return db;
+    }
+
+    mutable std::mutex mutex_;       // Protege la lista de conexiones
+    std::mutex write_mutex_;         // Serializa las escrituras
+    std::string path_;
+    std::unique_ptr<DatabaseConnection> writer_;
+    std::vector<std::unique_ptr<DatabaseConnection>> readers_;
+    std::atomic<uint64_t> generation_{0};  // 0 = cerrada; cambia en cada open()
+};
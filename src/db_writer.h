@@ -0,0 +1,234 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+#include <sqlite3.h>
+#include "db_pool.h"
+#include "metrics.h"
+#include "logging.h"
+
+// Fila pendiente de guardar en chat_history
+struct PendingWrite {
+    std::string question;
+    std::string answer;
+    std::string language;
+};
+
+// Métricas de la cola de escritura diferida
+struct WriteBehindStats {
+    size_t queue_depth = 0;
+    uint64_t enqueued = 0;
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    uint64_t batches = 0;
+    double last_flush_ms = 0.0;
+    double max_flush_ms = 0.0;
+    double avg_flush_ms = 0.0;
+};
+
+// Crea el índice único usado por INSERT ... ON CONFLICT. Si la tabla tenía
+// duplicados de versiones anteriores se conserva solo la fila más antigua.
+inline bool ensure_unique_index(sqlite3* db, const std::string& index_name, const std::string& columns) {
+    sqlite3_stmt* stmt = nullptr;
+    bool exists = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type='index' AND name=?;", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, index_name.c_str(), -1, SQLITE_STATIC);
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    if (exists) {
+        return true;
+    }
+
+    std::string sql =
+        "DELETE FROM chat_history WHERE id NOT IN (SELECT MIN(id) FROM chat_history GROUP BY " + columns + ");"
+        "CREATE UNIQUE INDEX IF NOT EXISTS " + index_name + " ON chat_history(" + columns + ");";
+
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        log_error("Error al crear índice único " + index_name + ": " + std::string(errMsg ? errMsg : ""));
+        sqlite3_free(errMsg);
+        return false;
+    }
+
+    log_info("Índice único " + index_name + " creado");
+    return true;
+}
+
+// Escritura diferida de chat_history. Los hilos de las peticiones solo
+// encolan la fila; un hilo en segundo plano agrupa las filas en una única
+// transacción cuando se llena un lote o pasa el intervalo de vaciado. Si la
+// cola está llena la fila se descarta (es solo caché de respuestas).
+class WriteBehindQueue {
+public:
+    // Inserta una fila con la conexión de escritura; devuelve false si falla
+    using RowWriter = std::function<bool(DatabaseConnection&, const PendingWrite&)>;
+
+    explicit WriteBehindQueue(size_t capacity = 1024, size_t batch_size = 64,
+                              std::chrono::milliseconds flush_interval = std::chrono::milliseconds(100))
+        : capacity_(capacity), batch_size_(batch_size), flush_interval_(flush_interval) {}
+
+    ~WriteBehindQueue() { stop(); }
+
+    WriteBehindQueue(const WriteBehindQueue&) = delete;
+    WriteBehindQueue& operator=(const WriteBehindQueue&) = delete;
+
+    void start(DatabasePool& pool, RowWriter writer) {
+        stop();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        pool_ = &pool;
+        writer_ = std::move(writer);
+        stopping_ = false;
+        thread_ = std::thread(&WriteBehindQueue::run, this);
+    }
+
+    // Vaciar lo pendiente y detener el hilo de escritura
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!thread_.joinable()) {
+                return;
+            }
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    bool enqueue(PendingWrite write) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!thread_.joinable() || queue_.size() >= capacity_) {
+                dropped_++;
+                return false;
+            }
+            queue_.push_back(std::move(write));
+            enqueued_++;
+            if (queue_.size() < batch_size_) {
+                return true;
+            }
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    WriteBehindStats stats() const {
+        WriteBehindStats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats.queue_depth = queue_.size();
+        }
+        stats.enqueued = enqueued_.load();
+        stats.written = written_.load();
+        stats.dropped = dropped_.load();
+        stats.batches = batches_.load();
+        stats.last_flush_ms = last_flush_us_.load() / 1000.0;
+        stats.max_flush_ms = max_flush_us_.load() / 1000.0;
+        stats.avg_flush_ms = stats.batches > 0 ? total_flush_us_.load() / 1000.0 / stats.batches : 0.0;
+        return stats;
+    }
+
+    // Duración de cada transacción de vaciado
+    const LatencyHistogram& flush_latency() const { return flush_latency_; }
+
+private:
+    void run() {
+        std::vector<PendingWrite> batch;
+        batch.reserve(batch_size_);
+
+        while (true) {
+            bool stopping = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait_for(lock, flush_interval_, [this] {
+                    return stopping_ || queue_.size() >= batch_size_;
+                });
+
+                while (!queue_.empty() && batch.size() < batch_size_) {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                }
+                stopping = stopping_ && queue_.empty();
+            }
+
+            if (!batch.empty()) {
+                flush(batch);
+                batch.clear();
+            }
+
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    void flush(const std::vector<PendingWrite>& batch) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t inserted = 0;
+
+        pool_->with_writer([&](DatabaseConnection& conn) {
+            char* errMsg = nullptr;
+            if (sqlite3_exec(conn.handle(), "BEGIN;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
+                log_error("Error al iniciar la transacción: " + std::string(errMsg ? errMsg : ""));
+                sqlite3_free(errMsg);
+                return;
+            }
+
+            for (const auto& write : batch) {
+                if (writer_(conn, write)) {
+                    inserted += sqlite3_changes(conn.handle());
+                }
+            }
+
+            if (sqlite3_exec(conn.handle(), "COMMIT;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
+                log_error("Error al confirmar el lote: " + std::string(errMsg ? errMsg : ""));
+                sqlite3_free(errMsg);
+                sqlite3_exec(conn.handle(), "ROLLBACK;", nullptr, nullptr, nullptr);
+                inserted = 0;
+            }
+        });
+
+        auto elapsed_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+
+        written_ += inserted;
+        batches_++;
+        last_flush_us_ = elapsed_us;
+        total_flush_us_ += elapsed_us;
+        flush_latency_.record_us(elapsed_us);
+        if (elapsed_us > max_flush_us_.load()) {
+            max_flush_us_ = elapsed_us;
+        }
+    }
+
+    const size_t capacity_;
+    const size_t batch_size_;
+    const std::chrono::milliseconds flush_interval_;
+
+    DatabasePool* pool_ = nullptr;
+    RowWriter writer_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<PendingWrite> queue_;
+    std::thread thread_;
+    bool stopping_ = false;
+
+    LatencyHistogram flush_latency_;
+    std::atomic<uint64_t> enqueued_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> last_flush_us_{0};
+    std::atomic<uint64_t> max_flush_us_{0};
+    std::atomic<uint64_t> total_flush_us_{0};
+};
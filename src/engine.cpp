@@ -0,0 +1,986 @@
+#include "engine.h"
+
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <string_view>
+#include <sqlite3.h>
+#include <nlohmann/json.hpp>
+#include "kb_snapshot.h"
+#include "kb_builtin.h"
+#include "text_utils.h"
+#include "prompts.h"
+#include "keyword_responses.h"
+#include "logging.h"
+#include "env_options.h"
+
+using json = nlohmann::json;
+
+const char* const TIER_NAMES[TIER_COUNT] = {"cache", "database", "knowledge_base", "llm", "keywords"};
+
+namespace {
+
+// Insert one row from the write-behind queue; duplicates are skipped by the unique index
+bool insert_chat_row(DatabaseConnection& conn, const PendingWrite& row) {
+    sqlite3_stmt* stmt = conn.prepare("INSERT INTO chat_history (question, answer, language, timestamp) VALUES (?, ?, ?, datetime('now')) "
+                                      "ON CONFLICT(question, language) DO NOTHING;");
+    if (!stmt) {
+        log_error("Error en preparación SQL: " + std::string(conn.last_error()));
+        return false;
+    }
+    
+    StatementReset reset(stmt);
+    sqlite3_bind_text(stmt, 1, row.question.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, row.answer.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, row.language.c_str(), -1, SQLITE_STATIC);
+    
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        log_error("Error al insertar en la base de datos: " + std::string(conn.last_error()));
+        return false;
+    }
+    
+    return true;
+}
+
+// Build the inverted index once, after the knowledge base is loaded
+void build_knowledge_index(KnowledgeBase& kb) {
+    kb.index.clear();
+    
+    for (uint32_t i = 0; i < kb.store.size(); ++i) {
+        kb.index.add_document(i, kb.store.normalized_question(i));
+    }
+    kb.index.finish();
+    
+    log_info("Índice invertido construido: " + std::to_string(kb.index.size()) +
+            " entradas, " + std::to_string(kb.index.term_count()) + " términos");
+}
+
+// A snapshot is only current while its dataset files are exactly what kb_compile
+// read. The recorded paths are added to inputs so that the reloader watches them.
+bool snapshot_is_current(const json& metadata, const std::string& snapshot_path, std::vector<std::string>& inputs) {
+    if (metadata.is_discarded() || !metadata.contains("sources") || !metadata["sources"].is_array() ||
+        metadata["sources"].empty()) {
+        log_error("La instantánea " + snapshot_path + " no registra sus datasets de origen (volver a ejecutar kb_compile); se usará el JSON");
+        return false;
+    }
+    
+    for (const auto& recorded : metadata["sources"]) {
+        if (!recorded.is_object() || !recorded.contains("path") || !recorded.contains("size") || !recorded.contains("mtime_ns")) {
+            log_error("La instantánea " + snapshot_path + " no registra el tamaño y la fecha de sus datasets (volver a ejecutar kb_compile); se usará el JSON");
+            return false;
+        }
+        const std::string path = recorded.value("path", "");
+        inputs.push_back(path);
+        
+        SnapshotSource current = snapshot_source_state(path);
+        if (current.size != recorded.value("size", int64_t{-1}) || current.mtime_ns != recorded.value("mtime_ns", int64_t{-1})) {
+            log_error("La instantánea " + snapshot_path + " está desactualizada: " + path +
+                      (current.size < 0 ? " ya no existe" : " cambió después de compilarla") +
+                      " (volver a ejecutar kb_compile); se usará el JSON");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Add a single entry to the knowledge base store
+void add_knowledge_entry(KnowledgeStore& store, const std::string& question, const std::string& answer) {
+    store.add(question, normalize_text(question), answer, Language::ES, store.intern_category("general"));
+}
+
+} // namespace
+
+EngineOptions EngineOptions::from_env() {
+    static const char* const BUDGET_VARIABLES[TIER_COUNT] = {
+        "TIER_BUDGET_CACHE_MS", "TIER_BUDGET_DB_MS", "TIER_BUDGET_KB_MS", "TIER_BUDGET_LLM_MS", "TIER_BUDGET_KEYWORDS_MS"
+    };
+    
+    EngineOptions options;
+    options.cache_capacity_bytes = env_count("CACHE_CAPACITY_BYTES", options.cache_capacity_bytes);
+    if (const char* env = std::getenv("SEMANTIC_CACHE")) options.semantic_cache = std::string(env) != "0";
+    if (const char* env = std::getenv("SEMANTIC_CACHE_THRESHOLD")) options.semantic_cache_threshold = std::strtod(env, nullptr);
+    options.semantic_cache_entries = env_count("SEMANTIC_CACHE_ENTRIES", options.semantic_cache_entries);
+    if (const char* env = std::getenv("FORCE_NEW_RESPONSE")) options.force_new_response = std::string(env) == "1";
+    if (const char* env = std::getenv("KB_SNAPSHOT")) options.kb_snapshot_path = env;
+    
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        options.tier_budgets[tier] = std::chrono::milliseconds(
+            env_millis(BUDGET_VARIABLES[tier], static_cast<long>(options.tier_budgets[tier].count())));
+    }
+    options.llm_queue_timeout = std::chrono::milliseconds(env_millis("LLM_QUEUE_TIMEOUT_MS", 5000));
+    options.batch_max_questions = env_count("BATCH_MAX_QUESTIONS", options.batch_max_questions);
+    options.batch_llm_parallelism = std::max<size_t>(1, env_count("BATCH_LLM_PARALLELISM", options.batch_llm_parallelism));
+    options.kb_reload_poll = std::chrono::milliseconds(env_millis("KB_RELOAD_POLL_MS", 2000));
+    options.llm = LlmClientOptions::from_env();
+    return options;
+}
+
+Engine::Engine(EngineOptions options)
+    : options_(std::move(options)),
+      cache_(options_.cache_capacity_bytes, options_.cache_ttl),
+      semantic_cache_(options_.semantic_cache_threshold, options_.semantic_cache_entries) {}
+
+Engine::~Engine() {
+    stop();
+}
+
+bool Engine::start() {
+    if (!init_database()) {
+        log_error("Error al inicializar la base de datos");
+        return false;
+    }
+    write_queue_.start(db_pool_, insert_chat_row);
+    llm_.start(options_.llm);
+    
+    // Prefer the binary snapshot; fall back to parsing the dataset JSON
+    std::shared_ptr<KnowledgeBase> kb = load_latest_knowledge_base(false);
+    if (!kb) {
+        log_error("No se pudo cargar la base de conocimiento principal (usando fuente alternativa)");
+        kb = default_knowledge_base();
+    }
+    knowledge_base_.publish(std::move(kb));
+    
+    // Reload in the background on SIGHUP or when one of the published version's inputs changes
+    kb_reloader_.start(knowledge_base_, [this] { return load_latest_knowledge_base(true); },
+                       options_.kb_reload_poll);
+    return true;
+}
+
+void Engine::stop() {
+    kb_reloader_.stop();
+    llm_.stop();
+    write_queue_.stop();
+    db_pool_.close();
+}
+
+// Create chat_history, or bring a table from an older version up to date
+bool Engine::init_database() {
+    if (!db_pool_.open(options_.db_path)) {
+        log_error("Error al abrir la base de datos: " + options_.db_path);
+        return false;
+    }
+    
+    bool ok = true;
+    db_pool_.with_writer([&](DatabaseConnection& conn) {
+        sqlite3* db = conn.handle();
+        
+        // language queda vacío cuando las respuestas no dependen del idioma
+        const char* sql =
+            "CREATE TABLE IF NOT EXISTS chat_history ("
+            "  id INTEGER PRIMARY KEY, "
+            "  question TEXT NOT NULL, "
+            "  answer TEXT NOT NULL, "
+            "  language TEXT NOT NULL DEFAULT '', "
+            "  timestamp DATETIME DEFAULT CURRENT_TIMESTAMP"
+            ");";
+        
+        char* errMsg = nullptr;
+        if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
+            std::string error = errMsg;
+            sqlite3_free(errMsg);
+            log_error("Error al crear tablas: " + error);
+            ok = false;
+            return;
+        }
+        
+        // Tablas de versiones anteriores: el servidor no guardaba el idioma y
+        // las más antiguas tampoco la fecha
+        bool has_language = false;
+        bool has_timestamp = false;
+        sqlite3_stmt* col_stmt;
+        if (sqlite3_prepare_v2(db, "PRAGMA table_info(chat_history);", -1, &col_stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(col_stmt) == SQLITE_ROW) {
+                const char* col_name = reinterpret_cast<const char*>(sqlite3_column_text(col_stmt, 1));
+                if (col_name && strcmp(col_name, "language") == 0) {
+                    has_language = true;
+                } else if (col_name && strcmp(col_name, "timestamp") == 0) {
+                    has_timestamp = true;
+                }
+            }
+            sqlite3_finalize(col_stmt);
+        }
+        
+        // ALTER TABLE no admite CURRENT_TIMESTAMP como valor por defecto; las
+        // inserciones ponen la fecha explícitamente
+        const std::pair<bool, const char*> migrations[] = {
+            {has_language, "ALTER TABLE chat_history ADD COLUMN language TEXT NOT NULL DEFAULT '';"},
+            {has_timestamp, "ALTER TABLE chat_history ADD COLUMN timestamp DATETIME;"}
+        };
+        for (const auto& [present, alter] : migrations) {
+            if (present) {
+                continue;
+            }
+            if (sqlite3_exec(db, alter, nullptr, nullptr, &errMsg) != SQLITE_OK) {
+                std::string error = errMsg;
+                sqlite3_free(errMsg);
+                log_error("Error al actualizar chat_history: " + error);
+                ok = false;
+                return;
+            }
+            log_info("chat_history actualizada: " + std::string(alter));
+        }
+        
+        // Clave única para que save_to_database use INSERT ... ON CONFLICT; la
+        // del servidor antiguo era solo la pregunta
+        sqlite3_exec(db, "DROP INDEX IF EXISTS idx_question_unique;", nullptr, nullptr, nullptr);
+        ok = ensure_unique_index(db, "idx_question_language", "question, language");
+    });
+    
+    if (!ok) {
+        return false;
+    }
+    
+    log_info("Base de datos inicializada correctamente (modo WAL)");
+    return true;
+}
+
+// Load one dataset JSON file and index it; nullptr if it can't be read or parsed
+std::shared_ptr<KnowledgeBase> Engine::load_knowledge_base(const std::string& kb_path) const {
+    std::ifstream file(kb_path);
+    if (!file.is_open()) {
+        log_error("No se pudo abrir el archivo en la ruta: " + kb_path);
+        return nullptr;
+    }
+    
+    auto kb = std::make_shared<KnowledgeBase>();
+    try {
+        json root;
+        file >> root;
+        kb->store.load_json(root, normalize_into);
+    } catch (const std::exception& e) {
+        log_error("Error al procesar el JSON " + kb_path + ": " + std::string(e.what()));
+        return nullptr;
+    }
+    
+    if (options_.complex_cases) {
+        log_info("Añadiendo respuestas para casos complejos...");
+        add_complex_case_entries(kb->store);
+    }
+    kb->store.shrink_to_fit();
+    
+    log_info("Base de conocimiento cargada desde " + kb_path + " con " +
+            std::to_string(kb->store.size()) + " entradas (" +
+            std::to_string(kb->store.memory_usage() / 1024) + " KB)");
+    kb->source = kb_path;
+    build_knowledge_index(*kb);
+    return kb;
+}
+
+// Map the precompiled binary snapshot (see kb_compile): no JSON parsing and
+// no index build, and every worker process shares the same page-cache copy
+std::shared_ptr<KnowledgeBase> Engine::load_knowledge_snapshot(const std::string& snapshot_path) const {
+    std::shared_ptr<const SnapshotFile> snapshot = SnapshotFile::open(snapshot_path);
+    if (!snapshot) {
+        return nullptr;
+    }
+    
+    json metadata = json::parse(snapshot->text(KbSection::METADATA), nullptr, false);
+    if (options_.complex_cases && (metadata.is_discarded() || !metadata.value("complex_cases", false))) {
+        log_error("La instantánea " + snapshot_path + " no incluye los casos complejos (compilar con --complex-cases)");
+        return nullptr;
+    }
+    
+    auto kb = std::make_shared<KnowledgeBase>();
+    kb->inputs.push_back(snapshot_path);
+    if (!snapshot_is_current(metadata, snapshot_path, kb->inputs)) {
+        return nullptr;
+    }
+    if (!kb->store.attach(snapshot) || !kb->index.attach(snapshot) || kb->index.size() != kb->store.size()) {
+        log_error("Instantánea inconsistente, se usará el JSON: " + snapshot_path);
+        return nullptr;
+    }
+    
+    log_info("Base de conocimiento proyectada desde " + snapshot_path + " con " +
+            std::to_string(kb->store.size()) + " entradas y " +
+            std::to_string(kb->index.term_count()) + " términos");
+    kb->source = snapshot_path;
+    return kb;
+}
+
+// Newest available knowledge base: the binary snapshot if it is current, then the
+// main dataset, then the alternative one (each from the first path that loads).
+// Reloads pass alternative_only_if_missing so that a main dataset caught
+// half-written fails the reload instead of swapping in the alternative. The
+// result's inputs are the files whose change would load something else: the
+// snapshot, the file actually loaded and, for the alternative, the main paths.
+std::shared_ptr<KnowledgeBase> Engine::load_latest_knowledge_base(bool alternative_only_if_missing) const {
+    std::shared_ptr<KnowledgeBase> kb = load_knowledge_snapshot(options_.kb_snapshot_path);
+    if (kb) {
+        return kb;
+    }
+    
+    bool primary_exists = false;
+    for (const auto& path : options_.kb_primary_paths) {
+        primary_exists = primary_exists || std::ifstream(path).is_open();
+        kb = load_knowledge_base(path);
+        if (kb) {
+            kb->inputs = {options_.kb_snapshot_path, path};
+            return kb;
+        }
+    }
+    if (!alternative_only_if_missing || !primary_exists) {
+        // Si falla, intentar con el archivo alternativo
+        for (const auto& path : options_.kb_alternative_paths) {
+            kb = load_knowledge_base(path);
+            if (kb) {
+                kb->inputs = {options_.kb_snapshot_path};
+                kb->inputs.insert(kb->inputs.end(), options_.kb_primary_paths.begin(), options_.kb_primary_paths.end());
+                kb->inputs.push_back(path);
+                return kb;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Minimal knowledge base used when no dataset could be loaded at startup
+std::shared_ptr<KnowledgeBase> Engine::default_knowledge_base() const {
+    log_info("Creando base de conocimiento predeterminada...");
+    auto kb = std::make_shared<KnowledgeBase>();
+    
+    // Añadir algunos ejemplos
+    add_knowledge_entry(kb->store, "¿Qué es una visa de trabajo?",
+                        "Una visa de trabajo es un documento oficial que permite a un extranjero trabajar legalmente en un país durante un período determinado. Los requisitos y procesos varían según el país emisor y el tipo de trabajo.");
+    
+    add_knowledge_entry(kb->store, "¿Cómo solicitar asilo?",
+                        "El proceso de solicitud de asilo generalmente implica presentarse ante las autoridades migratorias y expresar temor de regresar al país de origen debido a persecución por motivos de raza, religión, nacionalidad, opinión política o pertenencia a un grupo social específico. Es recomendable buscar asesoría legal especializada.");
+    
+    if (options_.complex_cases) {
+        add_complex_case_entries(kb->store, true);
+    }
+    
+    log_info("Base de conocimiento predeterminada creada con " + std::to_string(kb->store.size()) + " entradas");
+    kb->source = "default";
+    // Cualquier dataset que aparezca sustituye a esta versión
+    kb->inputs = {options_.kb_snapshot_path};
+    kb->inputs.insert(kb->inputs.end(), options_.kb_primary_paths.begin(), options_.kb_primary_paths.end());
+    kb->inputs.insert(kb->inputs.end(), options_.kb_alternative_paths.begin(), options_.kb_alternative_paths.end());
+    build_knowledge_index(*kb);
+    return kb;
+}
+
+// Language stored with an answer: the question's with per_language, otherwise empty
+std::string Engine::storage_language(const std::string& language) const {
+    return options_.per_language ? language : std::string();
+}
+
+// Search database for an answer using this thread's read connection
+std::string Engine::search_database(const std::string& question, const std::string& language) {
+    DatabaseConnection* conn = db_pool_.reader();
+    if (!conn) {
+        log_error("Base de datos no inicializada");
+        return "";
+    }
+    
+    sqlite3_stmt* stmt = conn->prepare("SELECT answer FROM chat_history WHERE question = ? AND language = ? LIMIT 1;");
+    if (!stmt) {
+        log_error("Error en preparación SQL: " + std::string(conn->last_error()));
+        return "";
+    }
+    
+    StatementReset reset(stmt);
+    const std::string stored_language = storage_language(language);
+    std::string answer;
+    sqlite3_bind_text(stmt, 1, question.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, stored_language.c_str(), -1, SQLITE_STATIC);
+    
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* result = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        if (result) {
+            answer = result;
+        }
+    }
+    
+    return answer;
+}
+
+// Look up stored answers for many questions with a few IN queries instead of one query each,
+// keyed by ShardedLruCache::make_key(question, stored language).
+// The placeholder list has a fixed size so the prepared statement is cached once; unused slots stay NULL.
+std::unordered_map<std::string, std::string> Engine::search_database_batch(const std::vector<std::string>& questions) {
+    static constexpr size_t CHUNK = 64;
+    static const std::string sql = [] {
+        std::string placeholders;
+        for (size_t i = 0; i < CHUNK; ++i) {
+            placeholders += i == 0 ? "?" : ",?";
+        }
+        return "SELECT question, language, answer FROM chat_history WHERE question IN (" + placeholders + ");";
+    }();
+    
+    std::unordered_map<std::string, std::string> answers;
+    DatabaseConnection* conn = db_pool_.reader();
+    if (!conn) {
+        log_error("Base de datos no inicializada");
+        return answers;
+    }
+    
+    for (size_t begin = 0; begin < questions.size(); begin += CHUNK) {
+        sqlite3_stmt* stmt = conn->prepare(sql);
+        if (!stmt) {
+            log_error("Error en preparación SQL: " + std::string(conn->last_error()));
+            return answers;
+        }
+        
+        StatementReset reset(stmt);
+        const size_t end = std::min(questions.size(), begin + CHUNK);
+        for (size_t i = begin; i < end; ++i) {
+            sqlite3_bind_text(stmt, static_cast<int>(i - begin + 1), questions[i].c_str(), -1, SQLITE_STATIC);
+        }
+        
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* question = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            const char* language = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            const char* answer = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            if (question && language && answer) {
+                answers.emplace(ShardedLruCache::make_key(question, language), answer);
+            }
+        }
+    }
+    
+    return answers;
+}
+
+// Save conversation to database asynchronously (batched by the write-behind queue)
+void Engine::save_to_database(const std::string& question, const std::string& answer, const std::string& language) {
+    if (!write_queue_.enqueue({question, answer, storage_language(language)})) {
+        log_error("Cola de escritura llena, descartando respuesta");
+    }
+}
+
+std::string Engine::search_knowledge_base(const KnowledgeBase& kb, const TokenizedText& query,
+                                          const std::string& language) const {
+    // Las palabras clave solo deciden algo con los casos complejos
+    QuestionKeywords keywords;
+    if (options_.complex_cases) {
+        keywords = scan_question_keywords(query.normalized());
+    }
+    return search_knowledge_base(kb, query, keywords, language);
+}
+
+std::string Engine::search_knowledge_base(const KnowledgeBase& kb, const TokenizedText& query,
+                                          const QuestionKeywords& keywords, const std::string& language) const {
+    const std::string& normalized_question = query.normalized();
+    const Language query_language = language_from_code(language);
+    
+    // Pregunta de TPS a EB1: la respuesta precargada del idioma de la consulta,
+    // la del período largo sin estatus o la general
+    if (options_.complex_cases && keywords.tps_eb1) {
+        log_debug(keywords.long_period ? "Detectado período largo sin estatus" : "No se detectó período largo sin estatus");
+        const std::string& builtin = complex_case_question(query_language, keywords.long_period);
+        long builtin_id = KnowledgeIndex::NO_MATCH;
+        if (!builtin.empty()) {
+            builtin_id = kb.index.find_exact(builtin, [&kb, query_language](uint32_t doc_id) {
+                return kb.store.language(doc_id) == query_language;
+            });
+        }
+        if (builtin_id != KnowledgeIndex::NO_MATCH) {
+            log_debug("Encontrada respuesta precargada para TPS a EB1");
+            return std::string(kb.store.answer(static_cast<uint32_t>(builtin_id)));
+        }
+    }
+    
+    std::function<bool(uint32_t)> same_language;
+    if (options_.per_language) {
+        same_language = [&kb, query_language](uint32_t doc_id) {
+            return kb.store.language(doc_id) == query_language;
+        };
+    }
+    
+    // Búsqueda exacta
+    long doc_id = kb.index.find_exact(normalized_question, same_language);
+    if (doc_id != KnowledgeIndex::NO_MATCH) {
+        return std::string(kb.store.answer(static_cast<uint32_t>(doc_id)));
+    }
+    
+    // Búsqueda por relevancia: la mejor entrada BM25 con suficientes palabras importantes en común
+    std::vector<SearchHit> hits = kb.index.search(query, 1, options_.kb_min_match_percent, same_language);
+    if (hits.empty()) {
+        return "";
+    }
+    
+    return std::string(kb.store.answer(hits.front().doc_id));
+}
+
+// Record how long a tier took and whether it produced the answer
+void Engine::record_tier(Tier tier, std::chrono::steady_clock::time_point start, bool hit) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    TierStats& stats = tier_stats_[tier];
+    stats.latency.record(elapsed);
+    if (hit) {
+        stats.hits++;
+    }
+    if (elapsed > options_.tier_budgets[tier]) {
+        stats.over_budget++;
+        if (log_enabled(LogLevel::DEBUG)) {
+            log_debug("Nivel fuera de presupuesto",
+                      {{"tier", TIER_NAMES[tier]}, {"ms", std::chrono::duration<double, std::milli>(elapsed).count()}});
+        }
+    }
+}
+
+// Look up an answer in the cache, the database and the knowledge base (in that order)
+std::string Engine::lookup_answer(const std::string& question, const TokenizedText& query,
+                                  const QuestionKeywords& keywords, const std::string& language,
+                                  std::string& source) {
+    // First check the in-memory cache
+    auto start = std::chrono::steady_clock::now();
+    const std::string cache_key = ShardedLruCache::make_key(query.normalized(), storage_language(language));
+    std::string answer = cache_.get(cache_key);
+    record_tier(TIER_CACHE, start, !answer.empty());
+    if (!answer.empty()) {
+        log_debug("Respuesta encontrada en caché", {{"tier", "cache"}});
+        source = "cache";
+        return answer;
+    }
+    
+    // Then check database cache
+    start = std::chrono::steady_clock::now();
+    answer = search_database(question, language);
+    record_tier(TIER_DATABASE, start, !answer.empty());
+    if (!answer.empty()) {
+        log_debug("Respuesta encontrada en la base de datos", {{"tier", "database"}});
+        cache_.put(cache_key, answer);
+        source = "database";
+        return answer;
+    }
+    
+    // Then check knowledge base; the version stays pinned for the whole lookup,
+    // so a concurrent reload can't free it
+    start = std::chrono::steady_clock::now();
+    answer = search_knowledge_base(*knowledge_base_.get(), query, keywords, language);
+    record_tier(TIER_KNOWLEDGE_BASE, start, !answer.empty());
+    if (!answer.empty()) {
+        log_debug("Respuesta encontrada en la base de conocimiento", {{"tier", "knowledge_base"}});
+        save_to_database(question, answer, language);
+        cache_.put(cache_key, answer);
+        source = "knowledge_base";
+        return answer;
+    }
+    
+    return "";
+}
+
+// Remember an answer produced outside the knowledge base
+void Engine::remember_answer(const std::string& question, const std::string& answer, const std::string& language) {
+    save_to_database(question, answer, language);
+    cache_.put(ShardedLruCache::make_key(normalize_text(question), storage_language(language)), answer);
+}
+
+// Only complex questions go to the LLM, and only while its tier is enabled
+bool Engine::should_use_llm(const TokenizedText& query, const QuestionKeywords& keywords) const {
+    return options_.tier_budgets[TIER_LLM].count() > 0 && is_complex_question(query, keywords);
+}
+
+// With per_language, an answer in another language than the question's
+bool Engine::wrong_language(const std::string& text, const std::string& language) const {
+    if (!options_.per_language) {
+        return false;
+    }
+    std::string detected_language = detect_language(text);
+    return (language == "es" && detected_language != "es") || (language == "en" && detected_language == "es");
+}
+
+// An LLM answer is usable unless it is empty, in the wrong language or a refusal
+// on a case we have a canned answer for
+bool Engine::accept_llm_answer(const std::string& question, const std::string& language, const LlmResult& result) const {
+    if (!result.ok || result.text.empty() || wrong_language(result.text, language)) {
+        return false;
+    }
+    return !(language == "es" && is_tps_eb1_question(normalize_text(question)) && is_refusal(result.text));
+}
+
+// Answer used when the LLM is skipped, fails or runs out of time
+std::string Engine::fallback_answer(const QuestionKeywords& keywords, const std::string& language) {
+    auto start = std::chrono::steady_clock::now();
+    std::string answer;
+    if (language == "es" && keywords.tps_eb1) {
+        answer = tps_eb1_fallback(keywords.long_period);
+    } else if (options_.per_language) {
+        answer = referral_answer(language);
+    } else {
+        answer = keyword_response(keywords.keyword_response);
+    }
+    record_tier(TIER_KEYWORDS, start, true);
+    return answer;
+}
+
+// Build the LLM request; a valid answer is stored when it completes, even if
+// the caller already gave up waiting, so the next identical question hits the cache.
+// Identical questions already waiting on Ollama (any endpoint) share that generation,
+// and only the request that started it stores the answer. Under overload the
+// question is shed (never reaches Ollama) once it would wait longer than max_queue_time.
+LlmRequest Engine::make_llm_request(const std::string& question, const std::string& language,
+                                    LlmPriority priority, std::chrono::milliseconds max_queue_time) {
+    LlmRequest request;
+    request.prompt = build_ollama_prompt(question, language);
+    request.coalesce_key = ShardedLruCache::make_key(normalize_text(question), language);
+    request.priority = priority;
+    request.max_queue_time = max_queue_time;
+    request.on_complete = [this, question, language](const LlmResult& result) {
+        if (result.ok && !result.shared) {
+            llm_generation_.record_ms(result.elapsed_ms);
+            llm_tokens_ += result.tokens;
+        }
+        if (accept_llm_answer(question, language, result)) {
+            if (!result.shared) {
+                remember_answer(question, result.text, language);
+                if (options_.semantic_cache) {
+                    TokenizedText query(question);
+                    semantic_cache_.insert(query, scan_question_keywords(query.normalized()), language, result.text);
+                }
+            }
+        } else if (result.shed) {
+            log_debug("Pregunta descartada por sobrecarga de Ollama: " + result.error);
+        } else {
+            log_error("Respuesta de Ollama descartada: " + (result.ok ? std::string("vacía, rechazo o en otro idioma") : result.error));
+        }
+    };
+    return request;
+}
+
+// Everything short of the LLM: canned complex cases, then cache -> DB -> KB, then
+// the fallback answer for questions the LLM wouldn't get. Empty response: ask the LLM.
+QueryAnswer Engine::answer_without_llm(const std::string& question, const TokenizedText& query,
+                                       const QuestionKeywords& keywords, const std::string& language) {
+    QueryAnswer answer;
+    const std::string& normalized_question = query.normalized();
+    
+    // Caso especial para preguntas de TPS a EB1: respuesta predefinida
+    if (options_.complex_cases && language == "es" && keywords.tps_eb1) {
+        log_debug("Caso específico detectado: TPS a EB1");
+        answer.response = tps_eb1_fallback(keywords.long_period);
+        answer.source = "knowledge_base";
+        return answer;
+    }
+    
+    if (!options_.force_new_response) {
+        answer.response = lookup_answer(question, query, keywords, language, answer.source);
+        if (!answer.response.empty()) {
+            return answer;
+        }
+    }
+    
+    answer.source = "keywords";
+    if (!should_use_llm(query, keywords)) {
+        log_debug("Generando respuesta de respaldo");
+        answer.response = fallback_answer(keywords, language);
+        remember_answer(question, answer.response, language);
+        return answer;
+    }
+    
+    // Reutilizar la respuesta de una pregunta parecida antes de llamar al modelo
+    if (options_.semantic_cache && !options_.force_new_response) {
+        SemanticLookup similar = semantic_cache_.lookup(query, keywords, language);
+        if (!similar.answer.empty()) {
+            log_debug("Respuesta encontrada en caché semántica (similitud " + std::to_string(similar.similarity) + ")");
+            cache_.put(ShardedLruCache::make_key(normalized_question, storage_language(language)), similar.answer);
+            answer.response = std::move(similar.answer);
+            answer.source = "cache";
+        }
+    }
+    return answer;
+}
+
+QueryAnswer Engine::answer_without_llm(const std::string& question) {
+    TokenizedText query(question);
+    return answer_without_llm(question, query, scan_question_keywords(query.normalized()), guess_language(query).code);
+}
+
+// Answer one question through all sources: cache -> DB -> KB -> LLM (within budget) -> fallback
+QueryAnswer Engine::answer_query(const std::string& question, const TokenizedText& query, const std::string& language) {
+    const QuestionKeywords keywords = scan_question_keywords(query.normalized());
+    QueryAnswer answer = answer_without_llm(question, query, keywords, language);
+    if (!answer.response.empty()) {
+        return answer;
+    }
+    
+    // Wait for the LLM no longer than its budget; the worker thread is released afterwards
+    log_debug("Pregunta compleja detectada, usando Ollama");
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + options_.tier_budgets[TIER_LLM];
+    std::future<LlmResult> pending = llm_.generate(
+        make_llm_request(question, language, LlmPriority::INTERACTIVE, options_.llm_queue_timeout));
+    
+    for (bool retried = false;; retried = true) {
+        if (pending.wait_until(deadline) != std::future_status::ready) {
+            record_tier(TIER_LLM, start, false);
+            log_error("Ollama superó su presupuesto de " + std::to_string(options_.tier_budgets[TIER_LLM].count()) +
+                      " ms, usando respuesta de respaldo");
+            break;
+        }
+        
+        LlmResult result = pending.get();
+        if (accept_llm_answer(question, language, result)) {
+            record_tier(TIER_LLM, start, true);
+            answer.response = std::move(result.text);
+            answer.source = "llm";
+            return answer;
+        }
+        
+        // Answer in the wrong language: one more try, within the same budget, with a
+        // more direct prompt (not shared: the first prompt's generation is the wrong one)
+        if (!retried && result.ok && wrong_language(result.text, language)) {
+            log_error("La respuesta fue generada en el idioma incorrecto. Generando una nueva respuesta...");
+            LlmRequest retry = make_llm_request(question, language, LlmPriority::INTERACTIVE, options_.llm_queue_timeout);
+            retry.prompt = build_retry_prompt(question, language);
+            retry.max_tokens = 800;
+            retry.coalesce_key.clear();
+            pending = llm_.generate(std::move(retry));
+            continue;
+        }
+        
+        record_tier(TIER_LLM, start, false);
+        answer.retry_after_s = result.retry_after_s;
+        break;
+    }
+    
+    // Not stored: a late LLM answer will take its place in the cache and database
+    answer.response = fallback_answer(keywords, language);
+    answer.degraded = true;
+    return answer;
+}
+
+// Concurrent identical questions attach to the one already being answered, so a
+// burst of the same question costs one lookup, one Ollama generation and one
+// database insert.
+QueryAnswer Engine::answer(const std::string& question) {
+    // Normalized and tokenized once; every tier below reuses it
+    TokenizedText query(question);
+    std::string language = guess_language(query).code;
+    bool shared = false;
+    QueryAnswer answer = inflight_queries_.run(ShardedLruCache::make_key(query.normalized(), language),
+                                               [&] { return answer_query(question, query, language); }, &shared);
+    if (shared) {
+        log_debug("Respuesta compartida con una pregunta idéntica en curso");
+    }
+    return answer;
+}
+
+void Engine::stream_llm_answer(const std::string& question, std::function<void(const std::string&)> on_token,
+                               std::function<void(const QueryAnswer&)> on_done) {
+    const std::string language = guess_language(TokenizedText(question)).code;
+    auto start = std::chrono::steady_clock::now();
+    LlmRequest request = make_llm_request(question, language, LlmPriority::INTERACTIVE, options_.llm_queue_timeout);
+    request.on_token = std::move(on_token);
+    request.on_complete = [this, question, language, start, on_done = std::move(on_done),
+                           store = std::move(request.on_complete)](const LlmResult& result) {
+        store(result);
+        QueryAnswer answer;
+        bool accepted = accept_llm_answer(question, language, result);
+        record_tier(TIER_LLM, start, accepted);
+        
+        if (accepted) {
+            answer.response = result.text;
+            answer.source = "llm";
+        } else {
+            answer.response = fallback_answer(scan_question_keywords(normalize_text(question)), language);
+            answer.source = "keywords";
+            answer.degraded = true;
+            answer.retry_after_s = result.retry_after_s;
+        }
+        on_done(answer);
+    };
+    
+    llm_.generate(std::move(request));
+}
+
+std::vector<BatchItem> Engine::answer_batch(const std::vector<std::string>& questions) {
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&start] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    
+    struct Unique {
+        explicit Unique(const std::string& text) : question(text), query(text) {}
+        std::string question;    // First spelling seen; used for the database and the LLM prompt
+        TokenizedText query;
+        QuestionKeywords keywords;
+        std::string language;
+        std::string cache_key;
+        std::string answer;
+        std::string source;
+        double ms = 0.0;
+        long retry_after_s = 0;
+    };
+    std::deque<Unique> uniques;    // deque: TokenizedText can't move, and the map keys point into it
+    std::unordered_map<std::string_view, size_t> unique_ids;
+    std::vector<size_t> item_unique(questions.size());
+    for (size_t i = 0; i < questions.size(); ++i) {
+        Unique& candidate = uniques.emplace_back(questions[i]);
+        auto [it, inserted] = unique_ids.try_emplace(candidate.query.normalized(), uniques.size() - 1);
+        if (!inserted) {
+            uniques.pop_back();
+        } else {
+            candidate.language = guess_language(candidate.query).code;
+            candidate.keywords = scan_question_keywords(candidate.query.normalized());
+            candidate.cache_key = ShardedLruCache::make_key(candidate.query.normalized(), storage_language(candidate.language));
+        }
+        item_unique[i] = it->second;
+    }
+    
+    auto resolve = [&](Unique& unique, std::string answer, const char* source) {
+        unique.answer = std::move(answer);
+        unique.source = source;
+        unique.ms = elapsed_ms();
+    };
+    
+    // Canned complex cases
+    if (options_.complex_cases) {
+        for (auto& unique : uniques) {
+            if (unique.language == "es" && unique.keywords.tps_eb1) {
+                resolve(unique, tps_eb1_fallback(unique.keywords.long_period), "knowledge_base");
+            }
+        }
+    }
+    
+    if (!options_.force_new_response) {
+        // Cache
+        for (auto& unique : uniques) {
+            if (!unique.source.empty()) {
+                continue;
+            }
+            std::string answer = cache_.get(unique.cache_key);
+            if (!answer.empty()) {
+                resolve(unique, std::move(answer), "cache");
+            }
+        }
+        
+        // Database: one IN query for every question still unanswered
+        std::vector<std::string> missing;
+        for (const auto& unique : uniques) {
+            if (unique.source.empty()) {
+                missing.push_back(unique.question);
+            }
+        }
+        if (!missing.empty()) {
+            std::unordered_map<std::string, std::string> stored = search_database_batch(missing);
+            for (auto& unique : uniques) {
+                if (!unique.source.empty()) {
+                    continue;
+                }
+                auto it = stored.find(ShardedLruCache::make_key(unique.question, storage_language(unique.language)));
+                if (it != stored.end()) {
+                    cache_.put(unique.cache_key, it->second);
+                    resolve(unique, std::move(it->second), "database");
+                }
+            }
+        }
+    }
+    
+    // Knowledge base: one pinned version for the whole batch
+    std::shared_ptr<const KnowledgeBase> kb = knowledge_base_.get();
+    std::vector<size_t> llm_pending;
+    for (size_t id = 0; id < uniques.size(); ++id) {
+        Unique& unique = uniques[id];
+        if (!unique.source.empty()) {
+            continue;
+        }
+        
+        if (!options_.force_new_response) {
+            std::string answer = search_knowledge_base(*kb, unique.query, unique.keywords, unique.language);
+            if (!answer.empty()) {
+                save_to_database(unique.question, answer, unique.language);
+                cache_.put(unique.cache_key, answer);
+                resolve(unique, std::move(answer), "knowledge_base");
+                continue;
+            }
+        }
+        
+        if (!should_use_llm(unique.query, unique.keywords)) {
+            std::string fallback = fallback_answer(unique.keywords, unique.language);
+            remember_answer(unique.question, fallback, unique.language);
+            resolve(unique, std::move(fallback), "keywords");
+            continue;
+        }
+        
+        if (options_.semantic_cache && !options_.force_new_response) {
+            SemanticLookup similar = semantic_cache_.lookup(unique.query, unique.keywords, unique.language);
+            if (!similar.answer.empty()) {
+                cache_.put(unique.cache_key, similar.answer);
+                resolve(unique, std::move(similar.answer), "cache");
+                continue;
+            }
+        }
+        llm_pending.push_back(id);
+    }
+    
+    // LLM fan-out. Completions may arrive after the batch gave up waiting, so the
+    // shared state outlives this call; late answers are still stored by make_llm_request.
+    struct LlmFanOut {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<std::pair<size_t, LlmResult>> done;
+    };
+    auto fan_out = std::make_shared<LlmFanOut>();
+    const auto deadline = std::chrono::steady_clock::now() + options_.tier_budgets[TIER_LLM];
+    std::vector<std::chrono::steady_clock::time_point> submitted_at(uniques.size());
+    size_t next = 0;
+    size_t in_flight = 0;
+    
+    while (next < llm_pending.size() || in_flight > 0) {
+        while (next < llm_pending.size() && in_flight < options_.batch_llm_parallelism) {
+            const size_t id = llm_pending[next++];
+            // Batch lane: interactive questions go first; never queue past the batch deadline
+            auto queue_time = std::min(options_.llm_queue_timeout, std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()));
+            LlmRequest request = make_llm_request(uniques[id].question, uniques[id].language, LlmPriority::BATCH,
+                                                  std::max(queue_time, std::chrono::milliseconds(1)));
+            request.on_complete = [fan_out, id, store = std::move(request.on_complete)](const LlmResult& result) {
+                store(result);
+                {
+                    std::lock_guard<std::mutex> lock(fan_out->mutex);
+                    fan_out->done.emplace_back(id, result);
+                }
+                fan_out->cv.notify_one();
+            };
+            submitted_at[id] = std::chrono::steady_clock::now();
+            llm_.generate(std::move(request));
+            in_flight++;
+        }
+        
+        std::vector<std::pair<size_t, LlmResult>> done;
+        {
+            std::unique_lock<std::mutex> lock(fan_out->mutex);
+            if (!fan_out->cv.wait_until(lock, deadline, [&] { return !fan_out->done.empty(); })) {
+                break;
+            }
+            done.swap(fan_out->done);
+        }
+        
+        for (auto& [id, result] : done) {
+            in_flight--;
+            Unique& unique = uniques[id];
+            bool accepted = accept_llm_answer(unique.question, unique.language, result);
+            record_tier(TIER_LLM, submitted_at[id], accepted);
+            if (accepted) {
+                resolve(unique, std::move(result.text), "llm");
+            } else {
+                unique.retry_after_s = result.retry_after_s;
+            }
+        }
+    }
+    
+    // Out of budget, never sent or rejected: fallback answer, not stored (a late LLM answer may replace it)
+    for (size_t id : llm_pending) {
+        Unique& unique = uniques[id];
+        if (unique.source.empty()) {
+            resolve(unique, fallback_answer(unique.keywords, unique.language), "keywords");
+        }
+    }
+    if (next < llm_pending.size() || in_flight > 0) {
+        log_error("Lote: " + std::to_string(llm_pending.size() - next + in_flight) +
+                  " preguntas sin respuesta de Ollama dentro del presupuesto, usando respuestas de respaldo");
+    }
+    
+    std::vector<BatchItem> items(questions.size());
+    for (size_t i = 0; i < questions.size(); ++i) {
+        const Unique& unique = uniques[item_unique[i]];
+        bool degraded = unique.source == "keywords" && should_use_llm(unique.query, unique.keywords);
+        items[i] = {unique.answer, unique.source, unique.ms, degraded, unique.retry_after_s};
+    }
+    return items;
+}
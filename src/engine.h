@@ -0,0 +1,227 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include "kb_reload.h"
+#include "db_pool.h"
+#include "db_writer.h"
+#include "answer_cache.h"
+#include "semantic_cache.h"
+#include "llm_client.h"
+#include "single_flight.h"
+#include "metrics.h"
+#include "tokenizer.h"
+#include "text_utils.h"
+
+// Núcleo de IA MIGRANTE (libiamigrante): la base de conocimiento, las cachés,
+// el pool de SQLite y el cliente de Ollama, compartidos por el servidor HTTP,
+// el cliente de línea de comandos y las herramientas de pruebas. Cada programa
+// crea un Engine con sus opciones y solo se ocupa de su propia entrada/salida.
+
+// Niveles de la cadena de respuesta: caché -> base de datos -> base de conocimiento -> Ollama -> palabras clave
+enum Tier { TIER_CACHE, TIER_DATABASE, TIER_KNOWLEDGE_BASE, TIER_LLM, TIER_KEYWORDS, TIER_COUNT };
+extern const char* const TIER_NAMES[TIER_COUNT];
+
+struct TierStats {
+    LatencyHistogram latency;   // Su recuento es el número de llamadas
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> over_budget{0};
+};
+
+// Lo que cambia entre programas. from_env() lee las variables de entorno
+// documentadas en el README; los valores por defecto son los del servidor.
+struct EngineOptions {
+    std::string db_path = "chatbot_data.db";
+
+    // Respuestas por idioma: la caché y la base de datos usan (pregunta, idioma)
+    // como clave, la base de conocimiento solo busca en el idioma de la
+    // pregunta, las respuestas de Ollama en otro idioma se reintentan y la
+    // respuesta de respaldo es la genérica en ese idioma (cliente). Si no, todo
+    // se indexa solo por la pregunta y el respaldo es por palabras clave.
+    bool per_language = false;
+
+    // Respuestas precargadas de TPS a EB1 (kb_builtin.h): se añaden a la base
+    // de conocimiento, se exigen en la instantánea y responden directamente
+    // las preguntas de ese caso en español
+    bool complex_cases = false;
+
+    // Porcentaje de palabras importantes que deben coincidir en la búsqueda BM25
+    size_t kb_min_match_percent = 50;
+
+    // Caché semántica delante de Ollama (SEMANTIC_CACHE, SEMANTIC_CACHE_THRESHOLD,
+    // SEMANTIC_CACHE_ENTRIES)
+    bool semantic_cache = true;
+    double semantic_cache_threshold = 0.6;
+    size_t semantic_cache_entries = 4096;
+
+    // Caché de respuestas en memoria (CACHE_CAPACITY_BYTES)
+    size_t cache_capacity_bytes = 64ull * 1024 * 1024;
+    std::chrono::seconds cache_ttl{3600};
+
+    // Saltarse la caché, la base de datos y la base de conocimiento (FORCE_NEW_RESPONSE=1)
+    bool force_new_response = false;
+
+    // Presupuesto de cada nivel (TIER_BUDGET_*_MS). Solo Ollama se corta: pasado
+    // su presupuesto se responde por palabras clave. 0 lo desactiva.
+    std::chrono::milliseconds tier_budgets[TIER_COUNT] = {
+        std::chrono::milliseconds(5), std::chrono::milliseconds(50), std::chrono::milliseconds(20),
+        std::chrono::milliseconds(15000), std::chrono::milliseconds(5)
+    };
+
+    // Espera máxima en la cola de Ollama antes de descartar la pregunta (LLM_QUEUE_TIMEOUT_MS)
+    std::chrono::milliseconds llm_queue_timeout{5000};
+
+    // Lotes: preguntas por lote y generaciones de Ollama en curso por lote
+    // (BATCH_MAX_QUESTIONS, BATCH_LLM_PARALLELISM)
+    size_t batch_max_questions = 100;
+    size_t batch_llm_parallelism = 4;
+
+    // Instantánea binaria (KB_SNAPSHOT) y datasets JSON, en orden de preferencia
+    std::string kb_snapshot_path = "../dataset/kb.snapshot";
+    std::vector<std::string> kb_primary_paths = {
+        "/mnt/proyectos/IA_MIGRANTE_AI/dataset/nolivos_immigration_ai_extended.json",
+        "../dataset/nolivos_immigration_ai_extended.json",
+        "/root/IA_MIGRANTE_API/dataset/nolivos_immigration_ai_extended.json"
+    };
+    std::vector<std::string> kb_alternative_paths = {
+        "/mnt/proyectos/IA_MIGRANTE_AI/dataset/nolivos_immigration_qa.json",
+        "../dataset/nolivos_immigration_qa.json",
+        "/root/IA_MIGRANTE_API/dataset/nolivos_immigration_qa.json"
+    };
+
+    // Recarga en segundo plano por SIGHUP o cambios en los archivos (KB_RELOAD_POLL_MS, 0 = desactivada)
+    std::chrono::milliseconds kb_reload_poll{2000};
+
+    LlmClientOptions llm;
+
+    static EngineOptions from_env();
+};
+
+// Respuesta a una pregunta
+struct QueryAnswer {
+    std::string response;
+    std::string source;         // Nivel que la dio: cache, database, knowledge_base, llm o keywords
+    bool degraded = false;      // Hacía falta Ollama pero se descartó, tardó o falló: respuesta de respaldo
+    long retry_after_s = 0;     // Si la cola de Ollama descartó la pregunta
+};
+
+// Una respuesta de un lote
+struct BatchItem {
+    std::string response;
+    std::string source;
+    double ms = 0.0;    // Desde el inicio del lote hasta que esta respuesta estuvo lista
+    bool degraded = false;
+    long retry_after_s = 0;
+};
+
+class Engine {
+public:
+    explicit Engine(EngineOptions options = EngineOptions());
+    ~Engine();
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    // Abre la base de datos, arranca la cola de escritura y el cliente de
+    // Ollama y carga la base de conocimiento (con su recarga en segundo plano).
+    // curl_global_init() corre a cargo del programa.
+    bool start();
+    void stop();
+
+    // Responder una pregunta por todos los niveles. Las preguntas idénticas
+    // simultáneas se responden una sola vez.
+    QueryAnswer answer(const std::string& question);
+
+    // Responder muchas preguntas a la vez: las repetidas una sola vez, la
+    // caché, la base de datos y la base de conocimiento para todas juntas y las
+    // que necesitan Ollama en paralelo dentro de un único presupuesto.
+    std::vector<BatchItem> answer_batch(const std::vector<std::string>& questions);
+
+    // Todo lo que no necesita Ollama: respuesta guardada o, si la pregunta no
+    // es compleja, la de respaldo. Vacía si hay que preguntar a Ollama.
+    QueryAnswer answer_without_llm(const std::string& question);
+
+    // Generar con Ollama enviando cada fragmento a on_token según llega;
+    // on_done recibe la respuesta final (de respaldo y degraded si Ollama no
+    // sirvió). Ambos se llaman desde el hilo del cliente de Ollama.
+    void stream_llm_answer(const std::string& question, std::function<void(const std::string&)> on_token,
+                           std::function<void(const QueryAnswer&)> on_done);
+
+    // Búsqueda en una versión de la base de conocimiento: la entrada cuya
+    // pregunta normalizada coincide exactamente o, si no hay, la mejor por BM25
+    // con al menos kb_min_match_percent % de palabras en común. Vacía si no hay.
+    // keywords, si ya se tiene, es scan_question_keywords de la misma pregunta.
+    std::string search_knowledge_base(const KnowledgeBase& kb, const TokenizedText& query,
+                                      const std::string& language) const;
+    std::string search_knowledge_base(const KnowledgeBase& kb, const TokenizedText& query,
+                                      const QuestionKeywords& keywords, const std::string& language) const;
+
+    // La versión actual queda retenida mientras se use el puntero
+    std::shared_ptr<const KnowledgeBase> knowledge_base() const { return knowledge_base_.get(); }
+    bool reload_knowledge_base(const std::string& reason) { return kb_reloader_.reload(reason); }
+
+    const EngineOptions& options() const { return options_; }
+    const TierStats& tier_stats(Tier tier) const { return tier_stats_[tier]; }
+    const ShardedLruCache& cache() const { return cache_; }
+    const SemanticCache& semantic_cache() const { return semantic_cache_; }
+    const WriteBehindQueue& write_queue() const { return write_queue_; }
+    const LlmClient& llm() const { return llm_; }
+    const SingleFlight<QueryAnswer>& inflight_queries() const { return inflight_queries_; }
+    KnowledgeBaseStats knowledge_base_stats() const { return kb_reloader_.stats(); }
+
+    // Generaciones de Ollama iniciadas por este proceso (una compartida cuenta una vez)
+    const LatencyHistogram& llm_generation() const { return llm_generation_; }
+    uint64_t llm_tokens() const { return llm_tokens_.load(); }
+
+private:
+    bool init_database();
+    std::shared_ptr<KnowledgeBase> load_knowledge_base(const std::string& kb_path) const;
+    std::shared_ptr<KnowledgeBase> load_knowledge_snapshot(const std::string& snapshot_path) const;
+    std::shared_ptr<KnowledgeBase> load_latest_knowledge_base(bool alternative_only_if_missing) const;
+    std::shared_ptr<KnowledgeBase> default_knowledge_base() const;
+
+    std::string storage_language(const std::string& language) const;
+    std::string search_database(const std::string& question, const std::string& language);
+    std::unordered_map<std::string, std::string> search_database_batch(const std::vector<std::string>& questions);
+    void save_to_database(const std::string& question, const std::string& answer, const std::string& language);
+
+    void record_tier(Tier tier, std::chrono::steady_clock::time_point start, bool hit);
+    std::string lookup_answer(const std::string& question, const TokenizedText& query,
+                              const QuestionKeywords& keywords, const std::string& language, std::string& source);
+    void remember_answer(const std::string& question, const std::string& answer, const std::string& language);
+    bool should_use_llm(const TokenizedText& query, const QuestionKeywords& keywords) const;
+    bool wrong_language(const std::string& text, const std::string& language) const;
+    bool accept_llm_answer(const std::string& question, const std::string& language, const LlmResult& result) const;
+    std::string fallback_answer(const QuestionKeywords& keywords, const std::string& language);
+    LlmRequest make_llm_request(const std::string& question, const std::string& language,
+                                LlmPriority priority, std::chrono::milliseconds max_queue_time);
+    QueryAnswer answer_without_llm(const std::string& question, const TokenizedText& query,
+                                   const QuestionKeywords& keywords, const std::string& language);
+    QueryAnswer answer_query(const std::string& question, const TokenizedText& query, const std::string& language);
+
+    EngineOptions options_;
+
+    DatabasePool db_pool_;
+    WriteBehindQueue write_queue_;
+    ShardedLruCache cache_;
+    SemanticCache semantic_cache_;
+
+    // Publicada estilo RCU: las peticiones leen la versión actual sin bloqueos
+    // mientras una recarga construye la siguiente
+    KnowledgeBaseHandle knowledge_base_;
+    KnowledgeBaseReloader kb_reloader_;
+
+    LlmClient llm_;
+    SingleFlight<QueryAnswer> inflight_queries_;
+
+    TierStats tier_stats_[TIER_COUNT];
+    LatencyHistogram llm_generation_;
+    std::atomic<uint64_t> llm_tokens_{0};
+};
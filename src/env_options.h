@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <cerrno>
+#include <cstdlib>
+#include <cstddef>
+#include "logging.h"
+
+// Lectura de opciones numéricas desde variables de entorno. Un valor que no
+// es un entero no negativo completo ("-1", "10ms", "", fuera de rango) se
+// rechaza con un error en el log y se usa el valor por defecto: con strtoull
+// "-1" daría 2^64 - 1 y desactivaría en silencio el límite correspondiente.
+namespace env_options_detail {
+
+inline bool parse_non_negative(const char* name, const char* text, long long& value) {
+    errno = 0;
+    char* end = nullptr;
+    value = std::strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || value < 0) {
+        log_error(std::string(name) + "=\"" + text + "\" no es un entero no negativo; se ignora");
+        return false;
+    }
+    return true;
+}
+
+} // namespace env_options_detail
+
+// Un número o un tamaño (entradas, bytes, hilos)
+inline size_t env_count(const char* name, size_t default_value) {
+    const char* env = std::getenv(name);
+    long long value = 0;
+    if (!env || !env_options_detail::parse_non_negative(name, env, value)) {
+        return default_value;
+    }
+    return static_cast<size_t>(value);
+}
+
+// Un tiempo en milisegundos (presupuestos, esperas, intervalos)
+inline long env_millis(const char* name, long default_value) {
+    const char* env = std::getenv(name);
+    long long value = 0;
+    if (!env || !env_options_detail::parse_non_negative(name, env, value)) {
+        return default_value;
+    }
+    return static_cast<long>(value);
+}
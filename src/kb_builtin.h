@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "kb_store.h"
+#include "text_normalize.h"
+
+// Respuestas precargadas para casos complejos (TPS a EB1) que no están en los
+// datasets. Las usa el cliente de línea de comandos al cargar el JSON y el
+// compilador de instantáneas con --complex-cases.
+struct BuiltinEntry {
+    const char* language;
+    bool long_period;           // Caso con un período largo sin estatus
+    const char* question;
+    const char* answer;
+};
+
+inline const BuiltinEntry* complex_case_entries(size_t& count) {
+    static const BuiltinEntry ENTRIES[] = {
+        // Caso estándar de TPS a EB1
+        {"es", false,
+         "¿Una persona que entró legalmente a EEUU con visa de turista y luego obtuvo TPS puede ajustar status basado en ser beneficiario derivado de EB1?",
+         "Para ajustar estatus como beneficiario derivado de EB1 después de una entrada legal con visa B2 y posterior TPS, se deben considerar varios factores:\n\n"
+           "1. La entrada legal con visa B2 es favorable, ya que la persona fue inspeccionada y admitida legalmente.\n\n"
+           "2. El período sin estatus entre el vencimiento de la visa B2 y la obtención del TPS puede ser perdonado bajo la sección 245(k) si fue menor a 180 días para casos de empleo como EB1.\n\n"
+           "3. El TPS proporciona un estatus legal temporal y autorización de trabajo, pero no resuelve automáticamente períodos previos sin estatus.\n\n"
+           "4. Para beneficiarios derivados de EB1 (cónyuges e hijos solteros menores de 21 años del beneficiario principal), aplican los mismos requisitos de admisibilidad.\n\n"
+           "En resumen, es posible que esta persona pueda ajustar su estatus si el período sin estatus fue menor a 180 días o si califica para otras excepciones. Se recomienda consultar con un abogado especializado en inmigración para analizar todos los detalles específicos del caso."},
+        // Caso de TPS a EB1 con período largo sin estatus
+        {"es", true,
+         "¿Una persona que entró legalmente a EEUU con visa de turista, estuvo años sin estatus y luego obtuvo TPS puede ajustar status como beneficiario derivado de EB1?",
+         "Para una persona que estuvo sin estatus por más de 180 días antes de obtener TPS, el ajuste a EB1 como beneficiario derivado enfrenta obstáculos significativos:\n\n"
+           "1. La entrada legal con visa B2 es favorable, ya que la persona fue inspeccionada y admitida legalmente.\n\n"
+           "2. Sin embargo, la sección 245(k) solo perdona hasta 180 días sin estatus para casos de empleo como EB1, EB2 y EB3. Con un período más largo sin estatus (años), generalmente no se puede ajustar dentro de EE.UU. a través de categorías basadas en empleo.\n\n"
+           "3. El TPS proporciona estatus legal temporal y autorización de trabajo, pero no elimina las barreras creadas por los largos períodos sin estatus antes de obtenerlo.\n\n"
+           "4. Opciones alternativas podrían incluir:\n"
+           "   - Proceso consular con perdón I-601 por presencia ilegal (implica salir de EE.UU.)\n"
+           "   - Verificar elegibilidad bajo sección 245(i) si existe una petición anterior al 30 de abril de 2001\n"
+           "   - Buscar otras bases para el ajuste como matrimonio con ciudadano, asilo o visa U\n\n"
+           "5. Para beneficiarios derivados de EB1 (cónyuges e hijos solteros menores de 21 años), aplican los mismos requisitos de admisibilidad que para el beneficiario principal.\n\n"
+           "Esta situación compleja requiere consulta con un abogado de inmigración especializado para evaluar todas las opciones disponibles según las circunstancias específicas."},
+        // Versión en inglés de TPS a EB1 estándar
+        {"en", false,
+         "Can someone who entered with a B2 visa and later got TPS adjust status as an EB1 derivative beneficiary?",
+         "To adjust status as an EB1 derivative beneficiary after legal entry with a B2 visa and subsequent TPS, several factors must be considered:\n\n"
+           "1. Legal entry with a B2 visa is favorable, as the person was inspected and legally admitted.\n\n"
+           "2. The out-of-status period between the B2 visa expiration and obtaining TPS can be forgiven under section 245(k) if it was less than 180 days for employment-based cases like EB1.\n\n"
+           "3. TPS provides temporary legal status and work authorization, but does not automatically resolve previous periods without status.\n\n"
+           "4. For EB1 derivative beneficiaries (spouses and unmarried children under 21 of the principal beneficiary), the same admissibility requirements apply.\n\n"
+           "In summary, this person may be able to adjust their status if the period without status was less than 180 days or if they qualify for other exceptions. It is recommended to consult with an immigration attorney to analyze all the specific details of the case."},
+        // Versión en inglés de TPS a EB1 con período largo sin estatus
+        {"en", true,
+         "Can someone who entered with a B2 visa, was out of status for years, and later got TPS adjust status as an EB1 derivative beneficiary?",
+         "For someone who was out of status for more than 180 days before obtaining TPS, adjustment to EB1 as a derivative beneficiary faces significant obstacles:\n\n"
+           "1. Legal entry with a B2 visa is favorable, as the person was inspected and legally admitted.\n\n"
+           "2. However, section 245(k) only forgives up to 180 days out of status for employment-based cases like EB1, EB2, and EB3. With a longer period out of status (years), one generally cannot adjust within the U.S. through employment-based categories.\n\n"
+           "3. TPS provides temporary legal status and work authorization but does not eliminate the barriers created by long periods out of status before obtaining it.\n\n"
+           "4. Alternative options might include:\n"
+           "   - Consular processing with I-601 waiver for unlawful presence (requires leaving the U.S.)\n"
+           "   - Checking eligibility under section 245(i) if a petition exists from before April 30, 2001\n"
+           "   - Seeking other bases for adjustment such as marriage to a citizen, asylum, or U visa\n\n"
+           "5. For EB1 derivative beneficiaries (spouses and unmarried children under 21), the same admissibility requirements apply as for the principal beneficiary.\n\n"
+           "This complex situation requires consultation with a specialized immigration attorney to evaluate all available options based on the specific circumstances."}
+    };
+    count = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+    return ENTRIES;
+}
+
+// Añadir las respuestas de casos complejos; spanish_only deja solo las dos en
+// español (base de conocimiento predeterminada cuando no hay dataset)
+inline void add_complex_case_entries(KnowledgeStore& store, bool spanish_only = false) {
+    size_t count = 0;
+    const BuiltinEntry* entries = complex_case_entries(count);
+    const uint16_t category = store.intern_category("casos complejos");
+    std::string normalized;
+    for (size_t i = 0; i < count; ++i) {
+        const Language language = language_from_code(entries[i].language);
+        if (spanish_only && language != Language::ES) {
+            continue;
+        }
+        normalize_into(entries[i].question, normalized);
+        store.add(entries[i].question, normalized, entries[i].answer, language, category);
+    }
+}
+
+// Pregunta normalizada de la respuesta precargada de TPS a EB1 para ese idioma
+// y caso; vacía si no hay. Con ella el motor encuentra la entrada con
+// KnowledgeIndex::find_exact en lugar de recorrer la base de conocimiento.
+inline const std::string& complex_case_question(Language language, bool long_period) {
+    static const std::vector<std::string> normalized = [] {
+        size_t count = 0;
+        const BuiltinEntry* entries = complex_case_entries(count);
+        std::vector<std::string> questions(count);
+        for (size_t i = 0; i < count; ++i) {
+            normalize_into(entries[i].question, questions[i]);
+        }
+        return questions;
+    }();
+    static const std::string none;
+
+    size_t count = 0;
+    const BuiltinEntry* entries = complex_case_entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (language_from_code(entries[i].language) == language && entries[i].long_period == long_period) {
+            return normalized[i];
+        }
+    }
+    return none;
+}
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <nlohmann/json.hpp>
+#include "kb_store.h"
+#include "kb_index.h"
+#include "kb_builtin.h"
+#include "kb_snapshot.h"
+#include "text_normalize.h"
+#include "logging.h"
+
+using json = nlohmann::json;
+
+// Compilador de la base de conocimiento: lee los datasets JSON, normaliza las
+// preguntas, construye el índice invertido y lo guarda todo en una instantánea
+// binaria que el servidor y el cliente proyectan con mmap al arrancar.
+//
+//   kb_compile [--complex-cases] <salida.snapshot> <dataset.json>...
+//
+// --complex-cases añade las respuestas precargadas de TPS a EB1 que el cliente
+// de línea de comandos espera encontrar en la base de conocimiento.
+
+int main(int argc, char* argv[]) {
+    bool complex_cases = false;
+    std::vector<std::string> paths;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--complex-cases") {
+            complex_cases = true;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    
+    if (paths.size() < 2) {
+        log_flush();
+        std::cout << "Uso: " << argv[0] << " [--complex-cases] <salida.snapshot> <dataset.json>..." << std::endl;
+        std::cout << "  --complex-cases: Añade las respuestas precargadas de casos complejos (cliente CLI)." << std::endl;
+        return 1;
+    }
+    
+    const auto start = std::chrono::steady_clock::now();
+    const std::string output_path = paths.front();
+    KnowledgeStore store;
+    json sources = json::array();
+    
+    for (size_t i = 1; i < paths.size(); ++i) {
+        std::ifstream file(paths[i]);
+        if (!file.is_open()) {
+            log_error("No se pudo abrir el archivo en la ruta: " + paths[i]);
+            return 1;
+        }
+        
+        try {
+            json root;
+            file >> root;
+            size_t added = store.load_json(root, normalize_into);
+            log_info(paths[i] + ": " + std::to_string(added) + " entradas");
+            SnapshotSource source = snapshot_source_state(paths[i]);
+            sources.push_back({{"path", source.path}, {"size", source.size}, {"mtime_ns", source.mtime_ns},
+                               {"entries", added}});
+        } catch (const std::exception& e) {
+            log_error("Error al procesar el JSON " + paths[i] + ": " + std::string(e.what()));
+            return 1;
+        }
+    }
+    
+    if (complex_cases) {
+        add_complex_case_entries(store);
+    }
+    
+    KnowledgeIndex index;
+    for (uint32_t id = 0; id < store.size(); ++id) {
+        index.add_document(id, store.normalized_question(id));
+    }
+    index.finish();
+    
+    json metadata;
+    metadata["format_version"] = SNAPSHOT_VERSION;
+    metadata["created_at"] = static_cast<int64_t>(std::time(nullptr));
+    metadata["entries"] = store.size();
+    metadata["terms"] = index.term_count();
+    metadata["complex_cases"] = complex_cases;
+    metadata["sources"] = sources;
+    
+    SnapshotWriter writer;
+    writer.add(KbSection::METADATA, metadata.dump());
+    store.save(writer);
+    index.save(writer);
+    if (!writer.write(output_path)) {
+        return 1;
+    }
+    
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    log_info("Instantánea escrita en " + output_path + ": " + std::to_string(store.size()) + " entradas, " +
+            std::to_string(index.term_count()) + " términos (" + std::to_string(elapsed.count()) + " ms)");
+    return 0;
+}
@@ -0,0 +1,419 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <cstdint>
+#include "tokenizer.h"
+#include "kb_snapshot.h"
+#include "logging.h"
+
+// Resultado de una búsqueda ordenada por relevancia
+struct SearchHit {
+    uint32_t doc_id;
+    double score;          // Puntuación BM25
+    size_t matched_words;  // Palabras importantes de la consulta presentes en la entrada
+};
+
+// Índice invertido sobre las preguntas de la base de conocimiento.
+// Se construye una sola vez al cargar los datos: cada palabra apunta a la
+// lista (ordenada) de entradas que la contienen junto con su frecuencia, de
+// modo que una búsqueda solo recorre las entradas que comparten palabras con
+// la consulta y las ordena con BM25.
+//
+// Tras add_document() hay que llamar a finish(), que deja el índice en forma
+// plana (bloques de texto, desplazamientos y tablas hash con sondeo lineal).
+// Esa misma forma es la que se guarda en la instantánea binaria y la que
+// attach() usa directamente desde el mmap.
+class KnowledgeIndex {
+public:
+    static constexpr long NO_MATCH = -1;
+
+    // Parámetros estándar de BM25
+    static constexpr double BM25_K1 = 1.2;
+    static constexpr double BM25_B = 0.75;
+
+    KnowledgeIndex() { refresh_views(); }
+
+    // Las vistas apuntan a los vectores propios: mover sí, copiar no
+    KnowledgeIndex(const KnowledgeIndex&) = delete;
+    KnowledgeIndex& operator=(const KnowledgeIndex&) = delete;
+
+    KnowledgeIndex(KnowledgeIndex&& other) noexcept { *this = std::move(other); }
+
+    KnowledgeIndex& operator=(KnowledgeIndex&& other) noexcept {
+        building_ = std::move(other.building_);
+        terms_ = std::move(other.terms_);
+        build_lengths_ = std::move(other.build_lengths_);
+        build_total_length_ = other.build_total_length_;
+        term_arena_ = std::move(other.term_arena_);
+        term_offsets_ = std::move(other.term_offsets_);
+        term_slots_ = std::move(other.term_slots_);
+        posting_begin_ = std::move(other.posting_begin_);
+        postings_ = std::move(other.postings_);
+        doc_lengths_ = std::move(other.doc_lengths_);
+        exact_arena_ = std::move(other.exact_arena_);
+        exact_offsets_ = std::move(other.exact_offsets_);
+        exact_slots_ = std::move(other.exact_slots_);
+        meta_ = std::move(other.meta_);
+        mapping_ = std::move(other.mapping_);
+        if (mapping_) {
+            views_ = other.views_;
+        } else {
+            refresh_views();
+        }
+        other.clear();
+        return *this;
+    }
+
+    void clear() {
+        mapping_.reset();
+        building_.clear();
+        terms_.clear();
+        build_lengths_.clear();
+        build_total_length_ = 0;
+        term_arena_.clear();
+        term_offsets_.clear();
+        term_slots_.clear();
+        posting_begin_.clear();
+        postings_.clear();
+        doc_lengths_.clear();
+        exact_arena_.clear();
+        exact_offsets_.assign(1, 0);
+        exact_slots_.clear();
+        meta_.clear();
+        refresh_views();
+    }
+
+    // Añadir una entrada; el texto debe venir ya normalizado y los ids en orden
+    // creciente. No es visible en las búsquedas hasta llamar a finish().
+    void add_document(uint32_t doc_id, std::string_view normalized_question) {
+        if (mapping_ || exact_offsets_.empty()) {
+            clear();
+        }
+        while (exact_offsets_.size() <= doc_id) {
+            exact_offsets_.push_back(static_cast<uint32_t>(exact_arena_.size()));
+        }
+        exact_arena_.append(normalized_question);
+        exact_offsets_.push_back(static_cast<uint32_t>(exact_arena_.size()));
+
+        size_t word_count = 0;
+        for_each_token(normalized_question, [&](std::string_view word) {
+            auto it = building_.find(word);
+            if (it == building_.end()) {
+                // La clave del mapa apunta a la copia que guarda terms_
+                terms_.emplace_back(word);
+                it = building_.emplace(terms_.back(), std::vector<Posting>()).first;
+            }
+            auto& list = it->second;
+            if (list.empty() || list.back().doc_id != doc_id) {
+                list.push_back({doc_id, 1});
+            } else {
+                list.back().term_freq++;
+            }
+            word_count++;
+        });
+
+        build_lengths_.resize(doc_id + 1, 0);
+        build_lengths_[doc_id] = static_cast<uint32_t>(word_count);
+        build_total_length_ += word_count;
+    }
+
+    // Pasar lo añadido a la forma plana y liberar las estructuras de construcción
+    void finish() {
+        std::vector<std::string_view> sorted(terms_.begin(), terms_.end());
+        std::sort(sorted.begin(), sorted.end());
+
+        term_arena_.clear();
+        term_offsets_.assign(1, 0);
+        posting_begin_.assign(1, 0);
+        postings_.clear();
+        for (std::string_view term : sorted) {
+            const auto& list = building_.at(term);
+            term_arena_.append(term);
+            term_offsets_.push_back(static_cast<uint32_t>(term_arena_.size()));
+            postings_.insert(postings_.end(), list.begin(), list.end());
+            posting_begin_.push_back(static_cast<uint32_t>(postings_.size()));
+        }
+
+        doc_lengths_ = std::move(build_lengths_);
+        meta_ = {doc_lengths_.size(), build_total_length_};
+
+        term_slots_.assign(slot_count(sorted.size()), 0);
+        for (uint32_t id = 0; id < sorted.size(); ++id) {
+            insert_slot(term_slots_, sorted[id], id);
+        }
+        exact_slots_.assign(slot_count(doc_lengths_.size()), 0);
+        for (uint32_t doc = 0; doc < doc_lengths_.size(); ++doc) {
+            insert_slot(exact_slots_, slice(exact_arena_, exact_offsets_, doc), doc);
+        }
+
+        building_.clear();
+        terms_.clear();
+        build_lengths_.clear();
+        build_total_length_ = 0;
+        refresh_views();
+    }
+
+    // Guardar el índice (ya terminado) en una instantánea
+    void save(SnapshotWriter& writer) const {
+        writer.add(KbSection::INDEX_META, views_.meta);
+        writer.add(KbSection::INDEX_TERM_ARENA, views_.term_arena);
+        writer.add(KbSection::INDEX_TERM_OFFSETS, views_.term_offsets);
+        writer.add(KbSection::INDEX_TERM_SLOTS, views_.term_slots);
+        writer.add(KbSection::INDEX_POSTING_BEGIN, views_.posting_begin);
+        writer.add(KbSection::INDEX_POSTINGS, views_.postings);
+        writer.add(KbSection::INDEX_DOC_LENGTHS, views_.doc_lengths);
+        writer.add(KbSection::INDEX_EXACT_ARENA, views_.exact_arena);
+        writer.add(KbSection::INDEX_EXACT_OFFSETS, views_.exact_offsets);
+        writer.add(KbSection::INDEX_EXACT_SLOTS, views_.exact_slots);
+    }
+
+    // Usar el índice guardado en una instantánea ya validada, sin copiarlo.
+    // Se comprueba que todos los desplazamientos e ids caen dentro de rango
+    // para que un archivo inconsistente no provoque lecturas fuera del mmap.
+    bool attach(std::shared_ptr<const SnapshotFile> snapshot) {
+        clear();
+
+        Views views;
+        views.meta = snapshot->section<uint64_t>(KbSection::INDEX_META);
+        views.term_arena = snapshot->text(KbSection::INDEX_TERM_ARENA);
+        views.term_offsets = snapshot->section<uint32_t>(KbSection::INDEX_TERM_OFFSETS);
+        views.term_slots = snapshot->section<uint32_t>(KbSection::INDEX_TERM_SLOTS);
+        views.posting_begin = snapshot->section<uint32_t>(KbSection::INDEX_POSTING_BEGIN);
+        views.postings = snapshot->section<Posting>(KbSection::INDEX_POSTINGS);
+        views.doc_lengths = snapshot->section<uint32_t>(KbSection::INDEX_DOC_LENGTHS);
+        views.exact_arena = snapshot->text(KbSection::INDEX_EXACT_ARENA);
+        views.exact_offsets = snapshot->section<uint32_t>(KbSection::INDEX_EXACT_OFFSETS);
+        views.exact_slots = snapshot->section<uint32_t>(KbSection::INDEX_EXACT_SLOTS);
+
+        const size_t terms = views.term_offsets.empty() ? 0 : views.term_offsets.size - 1;
+        const size_t docs = views.doc_lengths.size;
+        bool ok = views.meta.size == 2 && views.meta[0] == docs &&
+                  valid_offsets(views.term_offsets, views.term_arena.size()) &&
+                  valid_offsets(views.posting_begin, views.postings.size) &&
+                  views.posting_begin.size == terms + 1 && views.posting_begin.back() == views.postings.size &&
+                  valid_offsets(views.exact_offsets, views.exact_arena.size()) &&
+                  views.exact_offsets.size == docs + 1 &&
+                  valid_slots(views.term_slots, terms) && valid_slots(views.exact_slots, docs);
+        for (size_t i = 0; ok && i < views.postings.size; ++i) {
+            ok = views.postings[i].doc_id < docs;
+        }
+        if (!ok) {
+            log_error("La instantánea no contiene un índice invertido válido");
+            return false;
+        }
+
+        mapping_ = std::move(snapshot);
+        views_ = views;
+        return true;
+    }
+
+    // Búsqueda exacta sobre el texto normalizado
+    long find_exact(const std::string& normalized_question,
+                    const std::function<bool(uint32_t)>& accept = nullptr) const {
+        if (views_.exact_slots.empty()) {
+            return NO_MATCH;
+        }
+        // Las entradas repetidas aparecen en el sondeo en orden de id, así que
+        // la primera aceptada es la de menor id
+        const size_t mask = views_.exact_slots.size - 1;
+        for (size_t slot = snapshot_hash(normalized_question) & mask; views_.exact_slots[slot] != 0;
+             slot = (slot + 1) & mask) {
+            const uint32_t doc = views_.exact_slots[slot] - 1;
+            if (slice(views_.exact_arena, views_.exact_offsets, doc) == normalized_question &&
+                (!accept || accept(doc))) {
+                return doc;
+            }
+        }
+        return NO_MATCH;
+    }
+
+    // Las k entradas más relevantes según BM25. Si min_percent > 0 solo se
+    // consideran las entradas donde más de min_percent % de las palabras de la
+    // consulta (de más de 3 caracteres, como la búsqueda difusa original)
+    // aparecen en la pregunta. Empates: gana la entrada cargada primero.
+    std::vector<SearchHit> search(const TokenizedText& query, size_t k, size_t min_percent = 0,
+                                  const std::function<bool(uint32_t)>& accept = nullptr) const {
+        return search(query.tokens(), k, min_percent, accept);
+    }
+
+    std::vector<SearchHit> search(const std::vector<std::string_view>& words, size_t k, size_t min_percent = 0,
+                                  const std::function<bool(uint32_t)>& accept = nullptr) const {
+        std::vector<SearchHit> hits;
+        const size_t doc_count = size();
+        if (words.empty() || k == 0 || doc_count == 0) {
+            return hits;
+        }
+
+        const double avg_length = static_cast<double>(views_.meta[1]) / doc_count;
+        std::unordered_map<uint32_t, size_t> positions;
+
+        for (std::string_view word : words) {
+            const long term = find_term(word);
+            if (term == NO_MATCH) continue;
+
+            const uint32_t begin = views_.posting_begin[term];
+            const uint32_t end = views_.posting_begin[term + 1];
+            const double df = static_cast<double>(end - begin);
+            const double idf = std::log(1.0 + (doc_count - df + 0.5) / (df + 0.5));
+
+            for (uint32_t p = begin; p < end; ++p) {
+                const Posting& posting = views_.postings[p];
+                auto [pos, inserted] = positions.try_emplace(posting.doc_id, hits.size());
+                if (inserted) {
+                    hits.push_back({posting.doc_id, 0.0, 0});
+                }
+
+                SearchHit& hit = hits[pos->second];
+                const double tf = posting.term_freq;
+                const double norm = 1.0 - BM25_B + BM25_B * views_.doc_lengths[posting.doc_id] / avg_length;
+                hit.score += idf * tf * (BM25_K1 + 1.0) / (tf + BM25_K1 * norm);
+                if (word.length() > 3) {
+                    hit.matched_words++;
+                }
+            }
+        }
+
+        hits.erase(std::remove_if(hits.begin(), hits.end(), [&](const SearchHit& hit) {
+            if (min_percent > 0 && hit.matched_words * 100 / words.size() <= min_percent) return true;
+            return accept && !accept(hit.doc_id);
+        }), hits.end());
+
+        auto by_score = [](const SearchHit& a, const SearchHit& b) {
+            return a.score != b.score ? a.score > b.score : a.doc_id < b.doc_id;
+        };
+        if (hits.size() > k) {
+            std::partial_sort(hits.begin(), hits.begin() + k, hits.end(), by_score);
+            hits.resize(k);
+        } else {
+            std::sort(hits.begin(), hits.end(), by_score);
+        }
+
+        return hits;
+    }
+
+    size_t size() const { return views_.doc_lengths.size; }
+    size_t term_count() const { return views_.term_offsets.empty() ? 0 : views_.term_offsets.size - 1; }
+    bool is_mapped() const { return mapping_ != nullptr; }
+
+private:
+    struct Posting {
+        uint32_t doc_id;
+        uint32_t term_freq;
+    };
+
+    struct Views {
+        std::string_view term_arena;
+        ArrayView<uint32_t> term_offsets;    // Término i: [offsets[i], offsets[i + 1])
+        ArrayView<uint32_t> term_slots;      // Hash -> id de término + 1 (0 = libre)
+        ArrayView<uint32_t> posting_begin;   // Postings del término i: [begin[i], begin[i + 1])
+        ArrayView<Posting> postings;
+        ArrayView<uint32_t> doc_lengths;
+        std::string_view exact_arena;
+        ArrayView<uint32_t> exact_offsets;
+        ArrayView<uint32_t> exact_slots;     // Hash -> id de entrada + 1 (0 = libre)
+        ArrayView<uint64_t> meta;            // doc_count, total_length
+    };
+
+    static std::string_view slice(std::string_view arena, ArrayView<uint32_t> offsets, uint32_t i) {
+        return arena.substr(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    // Tabla como mucho al 50 %, tamaño potencia de dos
+    static size_t slot_count(size_t keys) {
+        size_t count = 1;
+        while (count < 2 * keys) {
+            count <<= 1;
+        }
+        return count;
+    }
+
+    static void insert_slot(std::vector<uint32_t>& slots, std::string_view key, uint32_t id) {
+        const size_t mask = slots.size() - 1;
+        size_t slot = snapshot_hash(key) & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id + 1;
+    }
+
+    static bool valid_offsets(ArrayView<uint32_t> offsets, size_t limit) {
+        if (offsets.empty() || offsets[0] != 0 || offsets.back() > limit) {
+            return false;
+        }
+        for (size_t i = 1; i < offsets.size; ++i) {
+            if (offsets[i] < offsets[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Potencia de dos, ids en rango y al menos un hueco libre (el sondeo termina)
+    static bool valid_slots(ArrayView<uint32_t> slots, size_t keys) {
+        if (slots.empty() || (slots.size & (slots.size - 1)) != 0 || slots.size <= keys) {
+            return false;
+        }
+        for (uint32_t value : slots) {
+            if (value > keys) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    long find_term(std::string_view word) const {
+        if (views_.term_slots.empty()) {
+            return NO_MATCH;
+        }
+        const size_t mask = views_.term_slots.size - 1;
+        for (size_t slot = snapshot_hash(word) & mask; views_.term_slots[slot] != 0; slot = (slot + 1) & mask) {
+            const uint32_t term = views_.term_slots[slot] - 1;
+            if (slice(views_.term_arena, views_.term_offsets, term) == word) {
+                return term;
+            }
+        }
+        return NO_MATCH;
+    }
+
+    void refresh_views() {
+        views_.term_arena = term_arena_;
+        views_.term_offsets = term_offsets_;
+        views_.term_slots = term_slots_;
+        views_.posting_begin = posting_begin_;
+        views_.postings = postings_;
+        views_.doc_lengths = doc_lengths_;
+        views_.exact_arena = exact_arena_;
+        views_.exact_offsets = exact_offsets_;
+        views_.exact_slots = exact_slots_;
+        views_.meta = meta_;
+    }
+
+    // Construcción
+    std::unordered_map<std::string_view, std::vector<Posting>> building_;
+    std::deque<std::string> terms_;   // Dueño de las claves de building_
+    std::vector<uint32_t> build_lengths_;
+    size_t build_total_length_ = 0;
+
+    // Forma plana (propia, o vacía si se usa una instantánea)
+    std::string term_arena_;
+    std::vector<uint32_t> term_offsets_;
+    std::vector<uint32_t> term_slots_;
+    std::vector<uint32_t> posting_begin_;
+    std::vector<Posting> postings_;
+    std::vector<uint32_t> doc_lengths_;
+    std::string exact_arena_;
+    std::vector<uint32_t> exact_offsets_ = {0};
+    std::vector<uint32_t> exact_slots_;
+    std::vector<uint64_t> meta_;
+
+    std::shared_ptr<const SnapshotFile> mapping_;
+    Views views_;
+};
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "kb_store.h"
+#include "kb_index.h"
+#include "logging.h"
+
+// Una versión completa e inmutable de la base de conocimiento: el almacén y
+// el índice se construyen juntos y nunca se modifican una vez publicados.
+struct KnowledgeBase {
+    KnowledgeStore store;
+    KnowledgeIndex index;
+    std::string source;       // Archivo del que se cargó
+    // Archivos cuyo cambio daría otra versión: la instantánea y los JSON que
+    // se cargarían en su lugar. Son los que vigila KnowledgeBaseReloader.
+    std::vector<std::string> inputs;
+    uint64_t version = 0;     // Lo asigna KnowledgeBaseHandle al publicar
+};
+
+// Métricas de las recargas
+struct KnowledgeBaseStats {
+    uint64_t version = 0;
+    size_t entries = 0;
+    size_t terms = 0;
+    std::string source;
+    uint64_t reloads = 0;
+    uint64_t failed_reloads = 0;
+    double last_reload_ms = 0.0;
+};
+
+// Publicación estilo RCU: cada petición toma con get() una referencia a la
+// versión actual y la usa hasta terminar; publish() cambia el puntero de forma
+// atómica. Los lectores nunca esperan a una recarga (se construye aparte) y la
+// versión anterior se libera cuando la suelta la última petición que la usaba.
+class KnowledgeBaseHandle {
+public:
+    std::shared_ptr<const KnowledgeBase> get() const {
+        return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+    }
+
+    void publish(std::shared_ptr<KnowledgeBase> knowledge_base) {
+        knowledge_base->version = ++version_;
+        std::atomic_store_explicit(&current_, std::shared_ptr<const KnowledgeBase>(std::move(knowledge_base)),
+                                   std::memory_order_release);
+    }
+
+private:
+    std::shared_ptr<const KnowledgeBase> current_ = std::make_shared<const KnowledgeBase>();
+    std::atomic<uint64_t> version_{0};
+};
+
+namespace kb_reload_detail {
+
+// atomic<bool> y atomic<int> sin bloqueos son seguros dentro de un manejador
+// de señales, igual que write()
+inline std::atomic<bool> reload_requested{false};
+inline std::atomic<int> wake_fd{-1};    // Extremo de escritura del pipe del recargador activo
+
+inline void on_sighup(int) {
+    reload_requested.store(true, std::memory_order_relaxed);
+    int fd = wake_fd.load(std::memory_order_relaxed);
+    if (fd >= 0) {
+        const int saved_errno = errno;
+        ssize_t ignored = ::write(fd, "h", 1);
+        (void)ignored;
+        errno = saved_errno;
+    }
+}
+
+} // namespace kb_reload_detail
+
+// Recarga en segundo plano. SIGHUP despierta al hilo al momento (por un
+// pipe en el que escribe el manejador de la señal); además, cada
+// poll_interval revisa si cambió la fecha de modificación de alguno de los
+// archivos de los que depende la versión publicada (KnowledgeBase::inputs).
+// En ambos casos llama al cargador y publica el resultado. reload() hace lo
+// mismo a petición (endpoint de administración). Si el cargador falla se
+// conserva la versión actual.
+class KnowledgeBaseReloader {
+public:
+    // Construye una versión nueva, o nullptr si no se pudo cargar
+    using Loader = std::function<std::shared_ptr<KnowledgeBase>()>;
+
+    KnowledgeBaseReloader() = default;
+    ~KnowledgeBaseReloader() { stop(); }
+
+    KnowledgeBaseReloader(const KnowledgeBaseReloader&) = delete;
+    KnowledgeBaseReloader& operator=(const KnowledgeBaseReloader&) = delete;
+
+    // Con poll_interval 0 no se vigilan los archivos; SIGHUP y reload() siguen funcionando
+    void start(KnowledgeBaseHandle& handle, Loader loader, std::chrono::milliseconds poll_interval) {
+        stop();
+
+        int fds[2];
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+            log_error("No se pudo crear el pipe del recargador: " + std::string(std::strerror(errno)));
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            handle_ = &handle;
+            loader_ = std::move(loader);
+            poll_interval_ = poll_interval;
+        }
+        watch(handle.get()->inputs);
+
+        wake_read_ = fds[0];
+        wake_write_ = fds[1];
+        stopping_ = false;
+        kb_reload_detail::wake_fd.store(wake_write_);
+        std::signal(SIGHUP, kb_reload_detail::on_sighup);
+        thread_ = std::thread(&KnowledgeBaseReloader::run, this);
+    }
+
+    // El manejador de SIGHUP queda instalado: sin recargador solo marca la petición
+    void stop() {
+        if (!thread_.joinable()) {
+            return;
+        }
+        stopping_ = true;
+        ssize_t ignored = ::write(wake_write_, "s", 1);
+        (void)ignored;
+        thread_.join();
+
+        int expected = wake_write_;
+        kb_reload_detail::wake_fd.compare_exchange_strong(expected, -1);
+        ::close(wake_read_);
+        ::close(wake_write_);
+        wake_read_ = -1;
+        wake_write_ = -1;
+    }
+
+    // Cargar y publicar una versión nueva; las recargas simultáneas se serializan
+    bool reload(const std::string& reason) {
+        std::lock_guard<std::mutex> reload_lock(reload_mutex_);
+        Loader loader;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            loader = loader_;
+        }
+        if (!loader) {
+            return false;
+        }
+
+        log_info("Recargando la base de conocimiento (" + reason + ")...");
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<KnowledgeBase> knowledge_base = loader();
+        auto elapsed_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+
+        if (!knowledge_base) {
+            failed_reloads_++;
+            log_error("La recarga falló; se mantiene la versión actual");
+            return false;
+        }
+
+        std::vector<std::string> inputs = knowledge_base->inputs;
+        handle_->publish(std::move(knowledge_base));
+        watch(inputs);
+        reloads_++;
+        last_reload_us_ = elapsed_us;
+        log_info("Base de conocimiento recargada en " + std::to_string(elapsed_us / 1000) + " ms");
+        return true;
+    }
+
+    KnowledgeBaseStats stats() const {
+        KnowledgeBaseStats stats;
+        if (handle_) {
+            std::shared_ptr<const KnowledgeBase> current = handle_->get();
+            stats.version = current->version;
+            stats.entries = current->store.size();
+            stats.terms = current->index.term_count();
+            stats.source = current->source;
+        }
+        stats.reloads = reloads_.load();
+        stats.failed_reloads = failed_reloads_.load();
+        stats.last_reload_ms = last_reload_us_.load() / 1000.0;
+        return stats;
+    }
+
+private:
+    static int64_t modification_time(const std::string& path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return -1;
+        }
+        return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    }
+
+    // Vigilar estos archivos a partir de su estado actual
+    void watch(const std::vector<std::string>& paths) {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        watched_ = paths;
+        mtimes_.clear();
+        for (const auto& path : watched_) {
+            mtimes_.push_back(modification_time(path));
+        }
+    }
+
+    // Primer archivo vigilado que cambió desde la última revisión ("" si ninguno)
+    std::string changed_input() {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        std::string changed;
+        for (size_t i = 0; i < watched_.size(); ++i) {
+            int64_t mtime = modification_time(watched_[i]);
+            if (mtime != mtimes_[i]) {
+                mtimes_[i] = mtime;
+                if (changed.empty()) {
+                    changed = watched_[i];
+                }
+            }
+        }
+        return changed;
+    }
+
+    void run() {
+        const int timeout_ms = poll_interval_.count() > 0 ? static_cast<int>(poll_interval_.count()) : -1;
+        while (true) {
+            pollfd wake{wake_read_, POLLIN, 0};
+            int ready = ::poll(&wake, 1, timeout_ms);
+            if (ready > 0) {
+                char drain[64];
+                while (::read(wake_read_, drain, sizeof(drain)) > 0) {
+                }
+            }
+            if (stopping_) {
+                return;
+            }
+
+            std::string reason;
+            if (kb_reload_detail::reload_requested.exchange(false)) {
+                reason = "SIGHUP";
+            }
+            if (timeout_ms > 0) {
+                std::string changed = changed_input();
+                if (reason.empty() && !changed.empty()) {
+                    reason = "cambió " + changed;
+                }
+            }
+
+            if (!reason.empty()) {
+                reload(reason);
+            }
+        }
+    }
+
+    KnowledgeBaseHandle* handle_ = nullptr;
+    Loader loader_;
+    std::chrono::milliseconds poll_interval_{1000};
+
+    std::mutex watch_mutex_;             // Protege watched_ y mtimes_ (hilo de vigilancia y reload())
+    std::vector<std::string> watched_;
+    std::vector<int64_t> mtimes_;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::atomic<bool> stopping_{false};
+    int wake_read_ = -1;                 // Pipe que despierta al hilo (SIGHUP o stop())
+    int wake_write_ = -1;
+    std::mutex reload_mutex_;
+
+    std::atomic<uint64_t> reloads_{0};
+    std::atomic<uint64_t> failed_reloads_{0};
+    std::atomic<uint64_t> last_reload_us_{0};
+};
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "logging.h"
+
+// Instantánea binaria de la base de conocimiento: preguntas normalizadas,
+// respuestas, idiomas, categorías e índice invertido ya construidos, listos
+// para proyectarse en memoria con mmap sin analizar nada. Varios procesos que
+// abren el mismo archivo comparten una única copia en la caché de páginas.
+//
+// Formato (little-endian):
+//   SnapshotHeader
+//   SnapshotSection[section_count]
+//   datos de cada sección, alineados a 8 bytes
+// El checksum cubre todo lo que sigue a la cabecera.
+
+// Vista de solo lectura sobre un array contiguo, en memoria propia o proyectada
+template <typename T>
+struct ArrayView {
+    const T* data = nullptr;
+    size_t size = 0;
+
+    ArrayView() = default;
+    ArrayView(const T* data, size_t size) : data(data), size(size) {}
+    ArrayView(const std::vector<T>& vector) : data(vector.data()), size(vector.size()) {}
+
+    const T& operator[](size_t i) const { return data[i]; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    const T& back() const { return data[size - 1]; }
+};
+
+// Secciones conocidas; los ids no cambian entre versiones del formato
+enum class KbSection : uint32_t {
+    METADATA = 1,               // JSON libre: origen, fecha, número de entradas
+    STORE_NORMALIZED_ARENA = 10,
+    STORE_NORMALIZED_OFFSETS,
+    STORE_TEXT_ARENA,
+    STORE_TEXT_OFFSETS,
+    STORE_LANGUAGES,
+    STORE_CATEGORIES,
+    STORE_CATEGORY_ARENA,
+    STORE_CATEGORY_OFFSETS,
+    INDEX_META = 30,            // doc_count, total_length
+    INDEX_TERM_ARENA,
+    INDEX_TERM_OFFSETS,
+    INDEX_TERM_SLOTS,
+    INDEX_POSTING_BEGIN,
+    INDEX_POSTINGS,
+    INDEX_DOC_LENGTHS,
+    INDEX_EXACT_ARENA,
+    INDEX_EXACT_OFFSETS,
+    INDEX_EXACT_SLOTS
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;        // BYTE_ORDER_MARK tal como lo escribió el compilador
+    uint64_t file_size;
+    uint64_t checksum;
+    uint32_t section_count;
+    uint32_t reserved;
+};
+
+struct SnapshotSection {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t offset;            // Desde el inicio del archivo
+    uint64_t count;             // Número de elementos
+};
+
+// Subir SNAPSHOT_VERSION cuando cambie el formato o la normalización/tokenización
+// del texto: una instantánea antigua se rechaza y se vuelve al JSON.
+constexpr char SNAPSHOT_MAGIC[8] = {'I', 'A', 'M', 'K', 'B', 'S', 'N', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+
+// Checksum de 64 bits procesando palabras de 8 bytes (varias veces más rápido
+// que byte a byte, así que validar al arrancar cuesta poco)
+inline uint64_t snapshot_checksum(const unsigned char* data, size_t size) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001B3ull;
+        h ^= h >> 32;
+    }
+    for (; i < size; ++i) {
+        h = (h ^ data[i]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+// Hash estable entre compilaciones (las tablas de la instantánea dependen de él)
+inline uint64_t snapshot_hash(std::string_view text) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (unsigned char c : text) {
+        h = (h ^ c) * 0x100000001B3ull;
+    }
+    return h ^ (h >> 29);
+}
+
+// Acumula (copiando) las secciones y las escribe en un archivo
+class SnapshotWriter {
+public:
+    template <typename T>
+    void add(KbSection id, ArrayView<T> values) {
+        add_raw(id, values.data, sizeof(T), values.size);
+    }
+
+    template <typename T>
+    void add(KbSection id, const std::vector<T>& values) {
+        add_raw(id, values.data(), sizeof(T), values.size());
+    }
+
+    void add(KbSection id, std::string_view text) {
+        add_raw(id, text.data(), 1, text.size());
+    }
+
+    // Escribe en path.tmp y renombra: quien tenga proyectada la versión
+    // anterior sigue leyendo el archivo viejo hasta que lo cierre
+    bool write(const std::string& path) const {
+        const uint64_t table_end = sizeof(SnapshotHeader) + sections_.size() * sizeof(SnapshotSection);
+        std::vector<SnapshotSection> table;
+        uint64_t offset = align(table_end);
+        for (const auto& pending : sections_) {
+            table.push_back({static_cast<uint32_t>(pending.id), pending.element_size, offset, pending.count});
+            offset = align(offset + pending.element_size * pending.count);
+        }
+
+        std::vector<unsigned char> image(offset, 0);
+        std::memcpy(image.data() + sizeof(SnapshotHeader), table.data(), table.size() * sizeof(SnapshotSection));
+        for (size_t i = 0; i < sections_.size(); ++i) {
+            if (!sections_[i].bytes.empty()) {
+                std::memcpy(image.data() + table[i].offset, sections_[i].bytes.data(), sections_[i].bytes.size());
+            }
+        }
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.byte_order = SNAPSHOT_BYTE_ORDER_MARK;
+        header.file_size = image.size();
+        header.section_count = static_cast<uint32_t>(table.size());
+        header.checksum = snapshot_checksum(image.data() + sizeof(SnapshotHeader), image.size() - sizeof(SnapshotHeader));
+        std::memcpy(image.data(), &header, sizeof(header));
+
+        const std::string tmp_path = path + ".tmp";
+        FILE* file = std::fopen(tmp_path.c_str(), "wb");
+        if (!file) {
+            log_error("No se pudo crear " + tmp_path + ": " + std::strerror(errno));
+            return false;
+        }
+        bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            log_error("No se pudo escribir la instantánea " + path + ": " + std::strerror(errno));
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Pending {
+        KbSection id;
+        uint32_t element_size;
+        uint64_t count;
+        std::vector<unsigned char> bytes;
+    };
+
+    static uint64_t align(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+    void add_raw(KbSection id, const void* data, size_t element_size, size_t count) {
+        const auto* begin = static_cast<const unsigned char*>(data);
+        sections_.push_back({id, static_cast<uint32_t>(element_size), count,
+                             std::vector<unsigned char>(begin, begin + element_size * count)});
+    }
+
+    std::vector<Pending> sections_;
+};
+
+// Estado de un dataset de origen. kb_compile lo guarda en los metadatos y al
+// cargar se compara con el actual: si el JSON cambió, la instantánea está
+// desactualizada. La ruta es absoluta para poder comprobarla desde otro directorio.
+struct SnapshotSource {
+    std::string path;
+    int64_t size = -1;          // -1 si el archivo no existe
+    int64_t mtime_ns = -1;
+};
+
+inline SnapshotSource snapshot_source_state(const std::string& path) {
+    SnapshotSource source;
+    char resolved[PATH_MAX];
+    source.path = ::realpath(path.c_str(), resolved) ? resolved : path;
+
+    struct stat info;
+    if (::stat(source.path.c_str(), &info) == 0) {
+        source.size = static_cast<int64_t>(info.st_size);
+        source.mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    }
+    return source;
+}
+
+// Instantánea abierta con mmap (solo lectura). Se comparte con shared_ptr:
+// el almacén y el índice que la usan la mantienen proyectada.
+class SnapshotFile {
+public:
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    ~SnapshotFile() {
+        if (base_) {
+            munmap(const_cast<unsigned char*>(base_), size_);
+        }
+    }
+
+    // nullptr (y el motivo en el log) si no existe, está corrupta o es de otra versión
+    static std::shared_ptr<const SnapshotFile> open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                log_debug("No hay instantánea en " + path);
+            } else {
+                log_error("No se pudo abrir la instantánea " + path + ": " + std::strerror(errno));
+            }
+            return nullptr;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+            log_error("Instantánea vacía o ilegible: " + path);
+            ::close(fd);
+            return nullptr;
+        }
+
+        const size_t size = static_cast<size_t>(info.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            log_error("mmap falló para " + path + ": " + std::strerror(errno));
+            return nullptr;
+        }
+
+        std::shared_ptr<SnapshotFile> file(new SnapshotFile(static_cast<const unsigned char*>(mapped), size));
+        if (!file->validate(path)) {
+            return nullptr;
+        }
+        return file;
+    }
+
+    // Vista tipada de una sección; vacía si falta o el tamaño de elemento no cuadra
+    template <typename T>
+    ArrayView<T> section(KbSection id) const {
+        const SnapshotSection* entry = find(id);
+        if (!entry || entry->element_size != sizeof(T)) {
+            return ArrayView<T>();
+        }
+        return ArrayView<T>(reinterpret_cast<const T*>(base_ + entry->offset), entry->count);
+    }
+
+    std::string_view text(KbSection id) const {
+        ArrayView<char> chars = section<char>(id);
+        return std::string_view(chars.data, chars.size);
+    }
+
+    bool has(KbSection id) const { return find(id) != nullptr; }
+    size_t size() const { return size_; }
+
+private:
+    SnapshotFile(const unsigned char* base, size_t size) : base_(base), size_(size) {}
+
+    const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(base_); }
+
+    const SnapshotSection* sections() const {
+        return reinterpret_cast<const SnapshotSection*>(base_ + sizeof(SnapshotHeader));
+    }
+
+    const SnapshotSection* find(KbSection id) const {
+        for (uint32_t i = 0; i < header().section_count; ++i) {
+            if (sections()[i].id == static_cast<uint32_t>(id)) {
+                return &sections()[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool validate(const std::string& path) const {
+        const SnapshotHeader& h = header();
+        if (std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0) {
+            log_error("No es una instantánea de la base de conocimiento: " + path);
+            return false;
+        }
+        if (h.version != SNAPSHOT_VERSION || h.byte_order != SNAPSHOT_BYTE_ORDER_MARK) {
+            log_error("Instantánea de otra versión (" + std::to_string(h.version) + "), hay que recompilarla: " + path);
+            return false;
+        }
+        const uint64_t table_end = sizeof(SnapshotHeader) + uint64_t(h.section_count) * sizeof(SnapshotSection);
+        if (h.file_size != size_ || table_end > size_) {
+            log_error("Instantánea truncada: " + path);
+            return false;
+        }
+        for (uint32_t i = 0; i < h.section_count; ++i) {
+            const SnapshotSection& s = sections()[i];
+            if (s.offset % 8 != 0 || s.offset > size_ ||
+                (s.element_size != 0 && s.count > (size_ - s.offset) / s.element_size)) {
+                log_error("Sección fuera de rango en la instantánea: " + path);
+                return false;
+            }
+        }
+        if (snapshot_checksum(base_ + sizeof(SnapshotHeader), size_ - sizeof(SnapshotHeader)) != h.checksum) {
+            log_error("Checksum incorrecto en la instantánea: " + path);
+            return false;
+        }
+        return true;
+    }
+
+    const unsigned char* base_;
+    size_t size_;
+};
@@ -0,0 +1,360 @@
+// Pruebas de la instantánea binaria (kb_snapshot.h, kb_store.h, kb_index.h).
+// Se ejecuta con ctest. Escribe una instantánea pequeña con SnapshotWriter,
+// comprueba que se proyecta y responde igual que el almacén original, y
+// después la corrompe de varias formas: SnapshotFile::open() debe rechazar
+// la cabecera, la tabla de secciones o el checksum incorrectos, y
+// KnowledgeStore::attach() / KnowledgeIndex::attach() el contenido
+// incoherente de una instantánea con el checksum correcto.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "kb_snapshot.h"
+#include "kb_store.h"
+#include "kb_index.h"
+#include "text_normalize.h"
+
+static size_t g_checks = 0;
+static size_t g_failures = 0;
+
+static void expect(bool condition, const std::string& what) {
+    g_checks++;
+    if (!condition) {
+        g_failures++;
+        std::cerr << "FALLO: " << what << "\n";
+    }
+}
+
+using Bytes = std::vector<unsigned char>;
+
+static Bytes read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return Bytes(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& path, const Bytes& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+static SnapshotHeader header_of(const Bytes& bytes) {
+    SnapshotHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    return header;
+}
+
+static void set_header(Bytes& bytes, const SnapshotHeader& header) {
+    std::memcpy(bytes.data(), &header, sizeof(header));
+}
+
+// Vuelve a calcular el checksum, para que solo falle la comprobación buscada
+static void reseal(Bytes& bytes) {
+    SnapshotHeader header = header_of(bytes);
+    header.checksum = snapshot_checksum(bytes.data() + sizeof(SnapshotHeader), bytes.size() - sizeof(SnapshotHeader));
+    set_header(bytes, header);
+}
+
+// Posición de la entrada de la tabla de secciones con ese id
+static size_t section_entry(const Bytes& bytes, KbSection id) {
+    const SnapshotHeader header = header_of(bytes);
+    for (uint32_t i = 0; i < header.section_count; ++i) {
+        const size_t position = sizeof(SnapshotHeader) + i * sizeof(SnapshotSection);
+        SnapshotSection section;
+        std::memcpy(&section, bytes.data() + position, sizeof(section));
+        if (section.id == static_cast<uint32_t>(id)) {
+            return position;
+        }
+    }
+    std::cerr << "La instantánea de prueba no tiene la sección " << static_cast<uint32_t>(id) << "\n";
+    std::exit(1);
+}
+
+static SnapshotSection section_of(const Bytes& bytes, KbSection id) {
+    SnapshotSection section;
+    std::memcpy(&section, bytes.data() + section_entry(bytes, id), sizeof(section));
+    return section;
+}
+
+static void set_section(Bytes& bytes, KbSection id, const SnapshotSection& section) {
+    std::memcpy(bytes.data() + section_entry(bytes, id), &section, sizeof(section));
+}
+
+// Escribe el uint32_t número `element` de una sección
+static void set_u32(Bytes& bytes, KbSection id, size_t element, uint32_t value) {
+    const SnapshotSection section = section_of(bytes, id);
+    std::memcpy(bytes.data() + section.offset + element * section.element_size, &value, sizeof(value));
+}
+
+static bool opens(const std::string& path, const Bytes& bytes) {
+    write_file(path, bytes);
+    return SnapshotFile::open(path) != nullptr;
+}
+
+// Se abre, pero el almacén o el índice la rechazan
+static bool store_attaches(const std::string& path, const Bytes& bytes) {
+    write_file(path, bytes);
+    auto snapshot = SnapshotFile::open(path);
+    KnowledgeStore store;
+    return snapshot && store.attach(snapshot);
+}
+
+static bool index_attaches(const std::string& path, const Bytes& bytes) {
+    write_file(path, bytes);
+    auto snapshot = SnapshotFile::open(path);
+    KnowledgeIndex index;
+    return snapshot && index.attach(snapshot);
+}
+
+int main() {
+    char directory_template[] = "/tmp/kb_snapshot_test.XXXXXX";
+    if (!mkdtemp(directory_template)) {
+        std::cerr << "No se pudo crear el directorio temporal\n";
+        return 1;
+    }
+    const std::string directory = directory_template;
+    const std::string good_path = directory + "/good.snapshot";
+    const std::string bad_path = directory + "/bad.snapshot";
+
+    // Instantánea de referencia
+    KnowledgeStore store;
+    const uint16_t category = store.intern_category("general");
+    const std::vector<std::pair<std::string, std::string>> entries = {
+        {"¿Qué es el TPS?", "El TPS es un estatus de protección temporal."},
+        {"¿Cómo solicito asilo?", "El asilo se solicita con el formulario I-589."},
+        {"What is a green card?", "A green card grants permanent residence."},
+    };
+    for (const auto& [question, answer] : entries) {
+        store.add(question, normalize_text(question), answer, question[0] == 'W' ? Language::EN : Language::ES, category);
+    }
+    KnowledgeIndex index;
+    for (uint32_t id = 0; id < store.size(); ++id) {
+        index.add_document(id, store.normalized_question(id));
+    }
+    index.finish();
+
+    SnapshotWriter writer;
+    writer.add(KbSection::METADATA, std::string_view("{\"entries\":3}"));
+    store.save(writer);
+    index.save(writer);
+    expect(writer.write(good_path), "SnapshotWriter::write");
+    const Bytes good = read_file(good_path);
+
+    // La instantánea intacta se proyecta y responde como el original
+    {
+        auto snapshot = SnapshotFile::open(good_path);
+        KnowledgeStore mapped_store;
+        KnowledgeIndex mapped_index;
+        expect(snapshot != nullptr, "la instantánea intacta se abre");
+        if (snapshot) {
+            expect(mapped_store.attach(snapshot) && mapped_index.attach(snapshot), "la instantánea intacta se proyecta");
+            expect(mapped_store.size() == entries.size(), "mismo número de entradas");
+            for (uint32_t id = 0; id < mapped_store.size() && id < entries.size(); ++id) {
+                expect(mapped_store.answer(id) == entries[id].second, "misma respuesta " + std::to_string(id));
+                expect(mapped_index.find_exact(normalize_text(entries[id].first)) == static_cast<long>(id),
+                       "búsqueda exacta " + std::to_string(id));
+            }
+            expect(snapshot->text(KbSection::METADATA) == "{\"entries\":3}", "metadatos");
+        }
+    }
+
+    // Archivo inexistente, vacío o más corto que la cabecera
+    expect(SnapshotFile::open(directory + "/no_existe.snapshot") == nullptr, "archivo inexistente");
+    expect(!opens(bad_path, Bytes()), "archivo vacío");
+    expect(!opens(bad_path, Bytes(good.begin(), good.begin() + sizeof(SnapshotHeader) - 1)), "más corto que la cabecera");
+
+    // Cabecera
+    {
+        Bytes bytes = good;
+        bytes[0] ^= 0xFF;
+        expect(!opens(bad_path, bytes), "magia incorrecta");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotHeader header = header_of(bytes);
+        header.version++;
+        set_header(bytes, header);
+        expect(!opens(bad_path, bytes), "otra versión del formato");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotHeader header = header_of(bytes);
+        header.byte_order = 0x04030201;
+        set_header(bytes, header);
+        expect(!opens(bad_path, bytes), "otro orden de bytes");
+    }
+
+    // Truncada: le faltan bytes al final, o la tabla de secciones no cabe
+    expect(!opens(bad_path, Bytes(good.begin(), good.end() - 8)), "truncada al final");
+    expect(!opens(bad_path, Bytes(good.begin(), good.begin() + sizeof(SnapshotHeader) + 4)), "truncada en la tabla");
+    {
+        Bytes bytes = good;
+        SnapshotHeader header = header_of(bytes);
+        header.section_count = 1u << 20;
+        set_header(bytes, header);
+        expect(!opens(bad_path, bytes), "tabla de secciones mayor que el archivo");
+    }
+    {
+        Bytes bytes = good;
+        bytes.resize(bytes.size() + 8, 0);
+        reseal(bytes);
+        expect(!opens(bad_path, bytes), "tamaño distinto del de la cabecera");
+    }
+
+    // Secciones fuera de rango (con el checksum recalculado)
+    {
+        Bytes bytes = good;
+        SnapshotSection section = section_of(bytes, KbSection::STORE_TEXT_ARENA);
+        section.offset = bytes.size() + 8;
+        set_section(bytes, KbSection::STORE_TEXT_ARENA, section);
+        reseal(bytes);
+        expect(!opens(bad_path, bytes), "sección que empieza después del final");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotSection section = section_of(bytes, KbSection::INDEX_POSTINGS);
+        section.count = bytes.size();
+        set_section(bytes, KbSection::INDEX_POSTINGS, section);
+        reseal(bytes);
+        expect(!opens(bad_path, bytes), "sección que termina después del final");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotSection section = section_of(bytes, KbSection::STORE_LANGUAGES);
+        section.count = UINT64_MAX / 2;
+        set_section(bytes, KbSection::STORE_LANGUAGES, section);
+        reseal(bytes);
+        expect(!opens(bad_path, bytes), "tamaño de sección que desborda");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotSection section = section_of(bytes, KbSection::STORE_TEXT_ARENA);
+        section.offset += 1;
+        set_section(bytes, KbSection::STORE_TEXT_ARENA, section);
+        reseal(bytes);
+        expect(!opens(bad_path, bytes), "sección sin alinear");
+    }
+
+    // Checksum: cualquier byte cambiado en los datos
+    {
+        Bytes bytes = good;
+        const SnapshotSection section = section_of(bytes, KbSection::STORE_TEXT_ARENA);
+        bytes[section.offset] ^= 0x01;
+        expect(!opens(bad_path, bytes), "checksum incorrecto");
+    }
+
+    // Contenido incoherente con el checksum correcto: lo rechaza attach()
+    {
+        Bytes bytes = good;
+        set_u32(bytes, KbSection::STORE_NORMALIZED_OFFSETS, 1, 1u << 30);
+        reseal(bytes);
+        expect(opens(bad_path, bytes) && !store_attaches(bad_path, bytes), "desplazamiento más allá del texto");
+    }
+    {
+        Bytes bytes = good;
+        const SnapshotSection section = section_of(bytes, KbSection::STORE_TEXT_OFFSETS);
+        set_u32(bytes, KbSection::STORE_TEXT_OFFSETS, 2, 0);
+        set_u32(bytes, KbSection::STORE_TEXT_OFFSETS, 1, static_cast<uint32_t>(section.count));
+        reseal(bytes);
+        expect(!store_attaches(bad_path, bytes), "desplazamientos no crecientes");
+    }
+    {
+        Bytes bytes = good;
+        set_u32(bytes, KbSection::STORE_NORMALIZED_OFFSETS, 0, 1);
+        reseal(bytes);
+        expect(!store_attaches(bad_path, bytes), "primer desplazamiento distinto de 0");
+    }
+    {
+        Bytes bytes = good;
+        const SnapshotSection section = section_of(bytes, KbSection::STORE_LANGUAGES);
+        bytes[section.offset] = 0x7F;
+        reseal(bytes);
+        expect(!store_attaches(bad_path, bytes), "idioma desconocido");
+    }
+    {
+        Bytes bytes = good;
+        const SnapshotSection section = section_of(bytes, KbSection::STORE_CATEGORIES);
+        const uint16_t category_id = 500;
+        std::memcpy(bytes.data() + section.offset, &category_id, sizeof(category_id));
+        reseal(bytes);
+        expect(!store_attaches(bad_path, bytes), "categoría fuera de la tabla");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotSection section = section_of(bytes, KbSection::STORE_CATEGORIES);
+        section.count--;
+        set_section(bytes, KbSection::STORE_CATEGORIES, section);
+        reseal(bytes);
+        expect(!store_attaches(bad_path, bytes), "una categoría de menos");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotSection section = section_of(bytes, KbSection::STORE_TEXT_ARENA);
+        section.id = 999;
+        set_section(bytes, KbSection::STORE_TEXT_ARENA, section);
+        reseal(bytes);
+        expect(opens(bad_path, bytes) && !store_attaches(bad_path, bytes), "falta una sección del almacén");
+    }
+    {
+        Bytes bytes = good;
+        SnapshotSection section = section_of(bytes, KbSection::STORE_NORMALIZED_OFFSETS);
+        section.element_size = 8;
+        section.count /= 2;
+        set_section(bytes, KbSection::STORE_NORMALIZED_OFFSETS, section);
+        reseal(bytes);
+        expect(!store_attaches(bad_path, bytes), "tamaño de elemento distinto");
+    }
+    {
+        Bytes bytes = good;
+        set_u32(bytes, KbSection::INDEX_POSTINGS, 0, 1000);   // doc_id del primer posting
+        reseal(bytes);
+        expect(opens(bad_path, bytes) && !index_attaches(bad_path, bytes), "posting de un documento inexistente");
+    }
+    {
+        Bytes bytes = good;
+        set_u32(bytes, KbSection::INDEX_META, 0, 1000);   // doc_count (parte baja)
+        reseal(bytes);
+        expect(!index_attaches(bad_path, bytes), "número de documentos incoherente");
+    }
+    {
+        Bytes bytes = good;
+        const SnapshotSection section = section_of(bytes, KbSection::INDEX_POSTING_BEGIN);
+        set_u32(bytes, KbSection::INDEX_POSTING_BEGIN, section.count - 1, 0);
+        reseal(bytes);
+        expect(!index_attaches(bad_path, bytes), "postings sin cerrar");
+    }
+    {
+        Bytes bytes = good;
+        const SnapshotSection section = section_of(bytes, KbSection::INDEX_EXACT_SLOTS);
+        for (size_t slot = 0; slot < section.count; ++slot) {
+            set_u32(bytes, KbSection::INDEX_EXACT_SLOTS, slot, 1000);
+        }
+        reseal(bytes);
+        expect(!index_attaches(bad_path, bytes), "tabla de búsqueda exacta fuera de rango");
+    }
+
+    // Una instantánea rechazada no deja a medias un almacén que ya tenía datos
+    {
+        Bytes bytes = good;
+        set_u32(bytes, KbSection::STORE_NORMALIZED_OFFSETS, 1, 1u << 30);
+        reseal(bytes);
+        write_file(bad_path, bytes);
+        KnowledgeStore mapped_store;
+        auto snapshot = SnapshotFile::open(good_path);
+        auto bad = SnapshotFile::open(bad_path);
+        expect(snapshot && mapped_store.attach(snapshot) && bad && !mapped_store.attach(bad) &&
+               mapped_store.size() == 0, "attach fallido deja el almacén vacío");
+    }
+
+    std::remove(good_path.c_str());
+    std::remove(bad_path.c_str());
+    ::rmdir(directory.c_str());
+
+    log_flush();
+    std::cout << "kb_snapshot: " << g_checks << " comprobaciones, " << g_failures << " fallos\n";
+    return g_failures == 0 ? 0 : 1;
+}
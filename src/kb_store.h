@@ -0,0 +1,328 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "kb_snapshot.h"
+#include "logging.h"
+
+// Idiomas soportados por la base de conocimiento
+enum class Language : uint8_t {
+    ES,
+    EN,
+    OTHER
+};
+
+inline Language language_from_code(std::string_view code) {
+    if (code == "es") return Language::ES;
+    if (code == "en") return Language::EN;
+    return Language::OTHER;
+}
+
+inline const char* language_code(Language language) {
+    switch (language) {
+        case Language::ES: return "es";
+        case Language::EN: return "en";
+        default: return "other";
+    }
+}
+
+// Base de conocimiento compacta en formato columnar (struct-of-arrays).
+// Las preguntas normalizadas viven juntas en un mismo bloque de memoria para
+// que los recorridos sean secuenciales; las preguntas originales y las
+// respuestas van en un segundo bloque. Cada entrada es un índice en los
+// vectores de desplazamientos, idiomas y categorías.
+//
+// Los mismos bloques pueden venir de una instantánea proyectada con mmap
+// (attach); los accesos leen siempre a través de views_, que apunta a la
+// memoria propia o a la instantánea.
+class KnowledgeStore {
+public:
+    // Escribe la versión normalizada del primer argumento en el segundo, que se
+    // reutiliza entre entradas para no reservar memoria por cada pregunta
+    using Normalizer = std::function<void(std::string_view, std::string&)>;
+
+    KnowledgeStore() { refresh_views(); }
+
+    KnowledgeStore(const KnowledgeStore&) = delete;
+    KnowledgeStore& operator=(const KnowledgeStore&) = delete;
+
+    KnowledgeStore(KnowledgeStore&& other) noexcept { *this = std::move(other); }
+
+    KnowledgeStore& operator=(KnowledgeStore&& other) noexcept {
+        normalized_arena_ = std::move(other.normalized_arena_);
+        text_arena_ = std::move(other.text_arena_);
+        normalized_offsets_ = std::move(other.normalized_offsets_);
+        text_offsets_ = std::move(other.text_offsets_);
+        languages_ = std::move(other.languages_);
+        categories_ = std::move(other.categories_);
+        category_names_ = std::move(other.category_names_);
+        category_ids_ = std::move(other.category_ids_);
+        mapping_ = std::move(other.mapping_);
+        if (mapping_) {
+            views_ = other.views_;  // Apuntan a la instantánea, que no se mueve
+        } else {
+            refresh_views();        // Los strings cortos (SSO) sí cambian de dirección
+        }
+        other.clear();
+        return *this;
+    }
+
+    void clear() {
+        mapping_.reset();
+        normalized_arena_.clear();
+        text_arena_.clear();
+        normalized_offsets_.assign(1, 0);
+        text_offsets_.assign(1, 0);
+        languages_.clear();
+        categories_.clear();
+        category_names_.clear();
+        category_ids_.clear();
+        refresh_views();
+    }
+
+    // Añadir una entrada y devolver su id
+    uint32_t add(std::string_view question, std::string_view normalized_question,
+                 std::string_view answer, Language language, uint16_t category) {
+        if (mapping_) {
+            detach();
+        }
+        if (normalized_offsets_.empty()) {
+            clear();
+        }
+
+        normalized_arena_.append(normalized_question);
+        normalized_offsets_.push_back(static_cast<uint32_t>(normalized_arena_.size()));
+
+        text_arena_.append(question);
+        text_offsets_.push_back(static_cast<uint32_t>(text_arena_.size()));
+        text_arena_.append(answer);
+        text_offsets_.push_back(static_cast<uint32_t>(text_arena_.size()));
+
+        languages_.push_back(language);
+        categories_.push_back(category);
+        refresh_views();
+
+        return static_cast<uint32_t>(languages_.size() - 1);
+    }
+
+    // Obtener (o registrar) el id de una categoría
+    uint16_t intern_category(const std::string& name) {
+        auto it = category_ids_.find(name);
+        if (it != category_ids_.end()) {
+            return it->second;
+        }
+        if (mapping_) {
+            detach();
+        }
+
+        uint16_t id = static_cast<uint16_t>(category_names_.size());
+        category_names_.push_back(name);
+        category_ids_.emplace(name, id);
+        return id;
+    }
+
+    // Cargar desde el JSON de los datasets. Acepta tanto {"data": [...]} como
+    // el formato por categorías {"Visa": [...], "Asilo": [...]}.
+    size_t load_json(const nlohmann::json& root, const Normalizer& normalize) {
+        size_t added = 0;
+        std::string normalized;
+
+        auto add_item = [&](const nlohmann::json& item, const std::string& category) {
+            if (!item.is_object() || !item.contains("answer")) {
+                return;
+            }
+
+            std::string question = item.contains("question") ? item["question"].get<std::string>() :
+                                   "¿" + category + "?"; // Crear una pregunta a partir de la categoría
+            std::string answer = item["answer"].get<std::string>();
+            std::string language = item.contains("language") ? item["language"].get<std::string>() : "es";
+            std::string item_category = item.contains("category") ? item["category"].get<std::string>() : category;
+
+            normalize(question, normalized);
+            add(question, normalized, answer, language_from_code(language), intern_category(item_category));
+            added++;
+        };
+
+        if (root.contains("data") && root["data"].is_array()) {
+            for (const auto& item : root["data"]) {
+                add_item(item, "general");
+            }
+        } else {
+            for (const auto& [category, questions] : root.items()) {
+                if (questions.is_array()) {
+                    for (const auto& item : questions) {
+                        add_item(item, category);
+                    }
+                }
+            }
+        }
+
+        return added;
+    }
+
+    // Liberar la capacidad sobrante tras la carga
+    void shrink_to_fit() {
+        normalized_arena_.shrink_to_fit();
+        text_arena_.shrink_to_fit();
+        normalized_offsets_.shrink_to_fit();
+        text_offsets_.shrink_to_fit();
+        languages_.shrink_to_fit();
+        categories_.shrink_to_fit();
+        refresh_views();
+    }
+
+    // Guardar las secciones del almacén en una instantánea
+    void save(SnapshotWriter& writer) const {
+        std::string category_arena;
+        std::vector<uint32_t> category_offsets = {0};
+        for (const auto& name : category_names_) {
+            category_arena += name;
+            category_offsets.push_back(static_cast<uint32_t>(category_arena.size()));
+        }
+
+        writer.add(KbSection::STORE_NORMALIZED_ARENA, views_.normalized_arena);
+        writer.add(KbSection::STORE_NORMALIZED_OFFSETS, views_.normalized_offsets);
+        writer.add(KbSection::STORE_TEXT_ARENA, views_.text_arena);
+        writer.add(KbSection::STORE_TEXT_OFFSETS, views_.text_offsets);
+        writer.add(KbSection::STORE_LANGUAGES, views_.languages);
+        writer.add(KbSection::STORE_CATEGORIES, views_.categories);
+        writer.add(KbSection::STORE_CATEGORY_ARENA, category_arena);
+        writer.add(KbSection::STORE_CATEGORY_OFFSETS, category_offsets);
+    }
+
+    // Usar directamente los datos de una instantánea ya validada. Solo se
+    // copian los nombres de categoría (unas decenas); el resto se lee del mmap.
+    bool attach(std::shared_ptr<const SnapshotFile> snapshot) {
+        clear();
+
+        Views views;
+        views.normalized_arena = snapshot->text(KbSection::STORE_NORMALIZED_ARENA);
+        views.text_arena = snapshot->text(KbSection::STORE_TEXT_ARENA);
+        views.normalized_offsets = snapshot->section<uint32_t>(KbSection::STORE_NORMALIZED_OFFSETS);
+        views.text_offsets = snapshot->section<uint32_t>(KbSection::STORE_TEXT_OFFSETS);
+        views.languages = snapshot->section<Language>(KbSection::STORE_LANGUAGES);
+        views.categories = snapshot->section<uint16_t>(KbSection::STORE_CATEGORIES);
+        std::string_view category_arena = snapshot->text(KbSection::STORE_CATEGORY_ARENA);
+        ArrayView<uint32_t> category_offsets = snapshot->section<uint32_t>(KbSection::STORE_CATEGORY_OFFSETS);
+
+        const size_t count = views.languages.size;
+        bool ok = views.normalized_offsets.size == count + 1 && views.text_offsets.size == 2 * count + 1 &&
+                  views.categories.size == count && !category_offsets.empty() &&
+                  valid_offsets(views.normalized_offsets, views.normalized_arena.size()) &&
+                  valid_offsets(views.text_offsets, views.text_arena.size()) &&
+                  valid_offsets(category_offsets, category_arena.size());
+        for (size_t i = 0; ok && i < count; ++i) {
+            ok = views.categories[i] < category_offsets.size - 1 && views.languages[i] <= Language::OTHER;
+        }
+        if (!ok) {
+            log_error("La instantánea no contiene un almacén de conocimiento válido");
+            return false;
+        }
+
+        for (size_t i = 0; i + 1 < category_offsets.size; ++i) {
+            std::string name(category_arena.substr(category_offsets[i], category_offsets[i + 1] - category_offsets[i]));
+            category_ids_.emplace(name, static_cast<uint16_t>(i));
+            category_names_.push_back(std::move(name));
+        }
+        mapping_ = std::move(snapshot);
+        views_ = views;
+        return true;
+    }
+
+    bool is_mapped() const { return mapping_ != nullptr; }
+
+    size_t size() const { return views_.languages.size; }
+    bool empty() const { return views_.languages.empty(); }
+
+    std::string_view normalized_question(uint32_t id) const {
+        return slice(views_.normalized_arena, views_.normalized_offsets[id], views_.normalized_offsets[id + 1]);
+    }
+
+    std::string_view question(uint32_t id) const {
+        return slice(views_.text_arena, views_.text_offsets[2 * id], views_.text_offsets[2 * id + 1]);
+    }
+
+    std::string_view answer(uint32_t id) const {
+        return slice(views_.text_arena, views_.text_offsets[2 * id + 1], views_.text_offsets[2 * id + 2]);
+    }
+
+    Language language(uint32_t id) const { return views_.languages[id]; }
+    uint16_t category(uint32_t id) const { return views_.categories[id]; }
+    const std::string& category_name(uint16_t category) const { return category_names_[category]; }
+
+    // Memoria ocupada por los datos (aproximada); con una instantánea, el
+    // tamaño del archivo proyectado, compartido con otros procesos
+    size_t memory_usage() const {
+        if (mapping_) {
+            return mapping_->size();
+        }
+        return normalized_arena_.capacity() + text_arena_.capacity() +
+               (normalized_offsets_.capacity() + text_offsets_.capacity()) * sizeof(uint32_t) +
+               languages_.capacity() * sizeof(Language) + categories_.capacity() * sizeof(uint16_t);
+    }
+
+private:
+    struct Views {
+        std::string_view normalized_arena;
+        std::string_view text_arena;
+        ArrayView<uint32_t> normalized_offsets;
+        ArrayView<uint32_t> text_offsets;
+        ArrayView<Language> languages;
+        ArrayView<uint16_t> categories;
+    };
+
+    static std::string_view slice(std::string_view arena, uint32_t begin, uint32_t end) {
+        return std::string_view(arena.data() + begin, end - begin);
+    }
+
+    // Desplazamientos crecientes, empezando en 0 y sin salirse del bloque
+    static bool valid_offsets(ArrayView<uint32_t> offsets, size_t arena_size) {
+        if (offsets.empty() || offsets[0] != 0 || offsets.back() > arena_size) {
+            return false;
+        }
+        for (size_t i = 1; i < offsets.size; ++i) {
+            if (offsets[i] < offsets[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void refresh_views() {
+        views_.normalized_arena = normalized_arena_;
+        views_.text_arena = text_arena_;
+        views_.normalized_offsets = normalized_offsets_;
+        views_.text_offsets = text_offsets_;
+        views_.languages = languages_;
+        views_.categories = categories_;
+    }
+
+    // Copiar a memoria propia lo que se lee de la instantánea antes de modificarlo
+    void detach() {
+        normalized_arena_.assign(views_.normalized_arena);
+        text_arena_.assign(views_.text_arena);
+        normalized_offsets_.assign(views_.normalized_offsets.begin(), views_.normalized_offsets.end());
+        text_offsets_.assign(views_.text_offsets.begin(), views_.text_offsets.end());
+        languages_.assign(views_.languages.begin(), views_.languages.end());
+        categories_.assign(views_.categories.begin(), views_.categories.end());
+        mapping_.reset();
+        refresh_views();
+    }
+
+    std::string normalized_arena_;
+    std::string text_arena_;
+    std::vector<uint32_t> normalized_offsets_ = {0};
+    std::vector<uint32_t> text_offsets_ = {0};
+    std::vector<Language> languages_;
+    std::vector<uint16_t> categories_;
+    std::vector<std::string> category_names_;
+    std::unordered_map<std::string, uint16_t> category_ids_;
+    std::shared_ptr<const SnapshotFile> mapping_;
+    Views views_;
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <array>
+#include <initializer_list>
+#include <cstdint>
+
+// Posición de una palabra clave encontrada en el texto
+struct KeywordMatch {
+    uint32_t keyword_id;  // Orden en que se añadió la palabra clave
+    size_t end;           // Posición justo después del último byte
+};
+
+// Autómata de Aho-Corasick sobre bytes: encuentra todas las palabras clave de
+// una tabla en una sola pasada, O(longitud del texto + coincidencias), en
+// lugar de un find() por palabra clave. Se construye una vez (add + build) y
+// después solo se lee, así que puede compartirse entre hilos. Las
+// transiciones se guardan como una tabla completa sobre un alfabeto
+// comprimido (solo los bytes que aparecen en alguna palabra clave).
+class KeywordMatcher {
+public:
+    KeywordMatcher() = default;
+
+    KeywordMatcher(std::initializer_list<std::string_view> keywords) {
+        for (auto keyword : keywords) {
+            add(keyword);
+        }
+        build();
+    }
+
+    uint32_t add(std::string_view keyword) {
+        keywords_.emplace_back(keyword);
+        return static_cast<uint32_t>(keywords_.size() - 1);
+    }
+
+    void build() {
+        // Alfabeto comprimido: la clase 0 agrupa los bytes que no aparecen
+        byte_class_.fill(0);
+        class_count_ = 1;
+        for (const auto& keyword : keywords_) {
+            for (unsigned char c : keyword) {
+                if (byte_class_[c] == 0) {
+                    byte_class_[c] = static_cast<uint16_t>(class_count_++);
+                }
+            }
+        }
+
+        // Trie
+        std::vector<std::vector<uint32_t>> outputs(1);
+        transitions_.assign(class_count_, NONE);
+        for (uint32_t id = 0; id < keywords_.size(); ++id) {
+            uint32_t state = 0;
+            for (unsigned char c : keywords_[id]) {
+                uint32_t& next = transitions_[state * class_count_ + byte_class_[c]];
+                if (next == NONE) {
+                    next = static_cast<uint32_t>(outputs.size());
+                    outputs.emplace_back();
+                    transitions_.resize(transitions_.size() + class_count_, NONE);
+                }
+                state = transitions_[state * class_count_ + byte_class_[c]];
+            }
+            if (!keywords_[id].empty()) {
+                outputs[state].push_back(id);
+            }
+        }
+
+        // Enlaces de fallo en anchura; las transiciones ausentes se resuelven
+        // ya aquí, así que la búsqueda nunca retrocede
+        const size_t state_count = outputs.size();
+        std::vector<uint32_t> fail(state_count, 0);
+        std::deque<uint32_t> queue;
+        for (size_t cls = 0; cls < class_count_; ++cls) {
+            uint32_t& next = transitions_[cls];
+            if (next == NONE) {
+                next = 0;
+            } else {
+                queue.push_back(next);
+            }
+        }
+        while (!queue.empty()) {
+            uint32_t state = queue.front();
+            queue.pop_front();
+            for (uint32_t id : outputs[fail[state]]) {
+                outputs[state].push_back(id);
+            }
+            for (size_t cls = 0; cls < class_count_; ++cls) {
+                uint32_t& next = transitions_[state * class_count_ + cls];
+                uint32_t fallback = transitions_[fail[state] * class_count_ + cls];
+                if (next == NONE) {
+                    next = fallback;
+                } else {
+                    fail[next] = fallback;
+                    queue.push_back(next);
+                }
+            }
+        }
+
+        // Salidas en formato compacto (CSR)
+        output_begin_.assign(state_count + 1, 0);
+        output_ids_.clear();
+        for (size_t state = 0; state < state_count; ++state) {
+            output_begin_[state] = static_cast<uint32_t>(output_ids_.size());
+            output_ids_.insert(output_ids_.end(), outputs[state].begin(), outputs[state].end());
+        }
+        output_begin_[state_count] = static_cast<uint32_t>(output_ids_.size());
+
+        // Guardar el destino ya multiplicado por class_count_ (desplazamiento de
+        // la fila) y marcar en el bit alto los estados con salidas, para que el
+        // bucle de búsqueda no multiplique ni consulte output_begin_ en cada byte
+        for (auto& next : transitions_) {
+            uint32_t row = next * static_cast<uint32_t>(class_count_);
+            next = outputs[next].empty() ? row : (row | HAS_OUTPUT);
+        }
+    }
+
+    // Llama a on_match(KeywordMatch) por cada aparición; si devuelve false se detiene
+    template <typename Fn>
+    void scan(std::string_view text, Fn&& on_match) const {
+        if (output_begin_.empty()) {
+            return;
+        }
+        uint32_t row = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            uint32_t next = transitions_[row + byte_class_[static_cast<unsigned char>(text[i])]];
+            row = next & ~HAS_OUTPUT;
+            if (next & HAS_OUTPUT) {
+                const size_t state = row / class_count_;
+                for (uint32_t o = output_begin_[state]; o < output_begin_[state + 1]; ++o) {
+                    if (!on_match(KeywordMatch{output_ids_[o], i + 1})) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<KeywordMatch> find_all(std::string_view text) const {
+        std::vector<KeywordMatch> matches;
+        scan(text, [&](const KeywordMatch& match) {
+            matches.push_back(match);
+            return true;
+        });
+        return matches;
+    }
+
+    // Palabra clave de menor id presente en el texto, o NO_MATCH
+    long first_keyword(std::string_view text) const {
+        long best = NO_MATCH;
+        scan(text, [&](const KeywordMatch& match) {
+            if (best == NO_MATCH || match.keyword_id < best) {
+                best = match.keyword_id;
+            }
+            return best != 0;
+        });
+        return best;
+    }
+
+    // Número de palabras clave distintas presentes en el texto
+    size_t count_distinct(std::string_view text) const {
+        std::vector<bool> seen(keywords_.size(), false);
+        size_t count = 0;
+        scan(text, [&](const KeywordMatch& match) {
+            if (!seen[match.keyword_id]) {
+                seen[match.keyword_id] = true;
+                count++;
+            }
+            return true;
+        });
+        return count;
+    }
+
+    bool contains_any(std::string_view text) const {
+        bool found = false;
+        scan(text, [&](const KeywordMatch&) {
+            found = true;
+            return false;
+        });
+        return found;
+    }
+
+    size_t keyword_count() const { return keywords_.size(); }
+    const std::string& keyword(uint32_t id) const { return keywords_[id]; }
+    size_t state_count() const { return output_begin_.empty() ? 0 : output_begin_.size() - 1; }
+
+    static constexpr long NO_MATCH = -1;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr uint32_t HAS_OUTPUT = 0x80000000u;
+
+    std::vector<std::string> keywords_;
+    std::array<uint16_t, 256> byte_class_{};
+    size_t class_count_ = 1;
+    std::vector<uint32_t> transitions_;   // fila + clase -> fila siguiente (| HAS_OUTPUT)
+    std::vector<uint32_t> output_begin_;
+    std::vector<uint32_t> output_ids_;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cmath>
+#include <utility>
+#include <initializer_list>
+#include "perfect_hash.h"
+#include "tokenizer.h"
+
+// Idioma detectado y confianza (probabilidad entre 0 y 1 de que sea ese idioma)
+struct LanguageGuess {
+    std::string code;
+    double confidence = 0.0;
+};
+
+struct TrigramFrequency {
+    std::string_view trigram;
+    int per_10k;  // Apariciones por cada 10.000 trigramas del corpus
+};
+
+// Perfil de un idioma: palabras vacías y trigramas de caracteres más
+// frecuentes (con la palabra rodeada de espacios, así " de" y "de " marcan
+// principio y final). Los textos deben venir normalizados con normalize_into.
+class LanguageProfile {
+public:
+    LanguageProfile(std::string code,
+                    std::initializer_list<std::string_view> stopwords,
+                    std::initializer_list<TrigramFrequency> trigrams)
+        : code_(std::move(code)), stopwords_(stopwords) {
+        std::vector<std::string_view> keys;
+        for (const auto& entry : trigrams) {
+            keys.push_back(entry.trigram);
+        }
+        trigrams_ = PerfectHashSet(keys);
+
+        // Peso = log(frecuencia / mínimo); los trigramas fuera del perfil no suman
+        weights_.assign(trigrams_.size(), 0.0);
+        for (const auto& entry : trigrams) {
+            long index = trigrams_.find(entry.trigram);
+            if (index != PerfectHashSet::NOT_FOUND && entry.per_10k > MIN_PER_10K) {
+                weights_[index] = std::log(static_cast<double>(entry.per_10k) / MIN_PER_10K);
+            }
+        }
+    }
+
+    const std::string& code() const { return code_; }
+
+    // Log-verosimilitud aproximada del texto en este idioma
+    double score(const std::vector<std::string_view>& words) const {
+        double total = 0.0;
+        char trigram[3];
+
+        for (std::string_view word : words) {
+            if (stopwords_.contains(word)) {
+                total += STOPWORD_WEIGHT;
+            }
+
+            // Trigramas de " palabra ", sin construir la cadena con espacios
+            const size_t padded = word.size() + 2;
+            auto at = [&](size_t i) { return i == 0 || i == padded - 1 ? ' ' : word[i - 1]; };
+            for (size_t i = 0; i + 3 <= padded; ++i) {
+                trigram[0] = at(i);
+                trigram[1] = at(i + 1);
+                trigram[2] = at(i + 2);
+                long index = trigrams_.find(std::string_view(trigram, 3));
+                if (index != PerfectHashSet::NOT_FOUND) {
+                    total += weights_[index];
+                }
+            }
+        }
+        return total;
+    }
+
+private:
+    static constexpr int MIN_PER_10K = 10;
+    static constexpr double STOPWORD_WEIGHT = 2.0;
+
+    std::string code_;
+    PerfectHashSet stopwords_;
+    PerfectHashSet trigrams_;
+    std::vector<double> weights_;
+};
+
+// Perfiles de inglés y español. Los trigramas salen de las preguntas y
+// respuestas de dataset/ (inmigración), así que están sesgados hacia ese
+// vocabulario, que es justo el de las consultas. En caso de empate gana el
+// primero (inglés), como hacía la detección anterior.
+inline const std::vector<LanguageProfile>& language_profiles() {
+    static const std::vector<LanguageProfile> profiles = {
+        LanguageProfile("en", {
+            "the", "of", "and", "a", "to", "in", "is", "you", "that", "it", "he", "was", "for",
+            "on", "are", "as", "with", "his", "they", "i", "at", "be", "this", "have", "from",
+            "or", "one", "had", "by", "word", "but", "not", "what", "all", "were", "we", "when",
+            "your", "can", "said", "there", "use", "an", "each", "which", "she", "do", "how",
+            "their", "if", "will", "up", "other", "about", "out", "many", "then", "them", "these",
+            "so", "some", "her", "would", "make", "like", "him", "into", "time", "has", "look"
+        }, {
+            {" th", 187}, {"the", 155}, {"he ", 120}, {"ion", 107}, {"on ", 93}, {"tio", 92},
+            {" an", 72}, {"or ", 70}, {" to", 70}, {"to ", 69}, {"ati", 69}, {" in", 69}, {" yo", 68},
+            {"you", 68}, {"ed ", 63}, {" re", 63}, {"ent", 61}, {"nd ", 57}, {"al ", 56}, {" of", 55},
+            {"es ", 55}, {"and", 55}, {" a ", 53}, {"of ", 52}, {"for", 51}, {"nt ", 49}, {" co", 49},
+            {" pr", 49}, {"is ", 48}, {"ing", 48}, {"ng ", 47}, {" fo", 46}, {" ca", 44}, {"in ", 43},
+            {"an ", 43}, {"er ", 42}, {"re ", 41}, {" s ", 40}, {"our", 39}, {" im", 38}, {"ou ", 36},
+            {"sta", 36}, {" be", 36}, {"pro", 35}, {"ons", 35}, {" st", 34}, {" or", 33}, {" is", 33},
+            {"ly ", 33}, {"gra", 31}, {" de", 31}, {"ur ", 31}, {"app", 30}, {" ap", 29}, {"mig", 29},
+            {"rat", 29}, {"imm", 29}, {"men", 29}, {"igr", 28}, {"mmi", 28}, {"ica", 27}, {"tat", 27},
+            {" u ", 27}, {"can", 26}, {"ate", 26}, {"at ", 26}, {"ces", 25}, {"iti", 25}, {"ide", 25},
+            {"en ", 25}, {"res", 24}, {"nce", 24}, {" wi", 24}, {"ns ", 23}, {"it ", 23}, {"con", 23},
+            {"se ", 23}, {"ess", 23}, {"le ", 23}, {"ts ", 22}, {" un", 22}, {"ant", 21}, {"ce ", 21},
+            {" ar", 21}, {"st ", 21}, {"tha", 20}, {"hat", 20}, {" it", 20}, {" le", 20}, {"ppl", 20},
+            {"ve ", 20}, {"are", 19}, {" no", 19}, {" wh", 19}, {"ase", 18}, {" pe", 18}, {" vi", 18},
+            {" if", 18}, {"if ", 18}, {"por", 18}
+        }),
+        LanguageProfile("es", {
+            "el", "la", "los", "las", "un", "una", "unos", "unas", "y", "o", "pero", "porque",
+            "como", "cuando", "donde", "cual", "quien", "que", "esto", "esta", "estos", "estas",
+            "ese", "esa", "esos", "esas", "para", "por", "con", "sin", "sobre", "bajo", "ante",
+            "entre", "desde", "hacia", "hasta", "segun", "durante", "mediante", "excepto",
+            "salvo", "menos", "mas", "muy", "mucho", "poco", "bastante", "demasiado", "casi",
+            "aproximadamente", "todo", "nada", "algo", "alguien", "nadie", "ninguno", "alguno"
+        }, {
+            {" de", 221}, {"de ", 167}, {"os ", 136}, {"ion", 110}, {"on ", 109}, {"es ", 104},
+            {"cio", 104}, {" es", 100}, {"ent", 96}, {" un", 81}, {"en ", 79}, {"te ", 76},
+            {"ar ", 74}, {" la", 74}, {"nte", 71}, {"aci", 71}, {" en", 71}, {"el ", 68}, {" re", 68},
+            {"est", 66}, {" pr", 65}, {" co", 62}, {" in", 62}, {"sta", 61}, {"la ", 61}, {"ado", 60},
+            {"as ", 59}, {" el", 56}, {"dos", 55}, {"ici", 54}, {" pa", 52}, {"ra ", 51}, {"res", 50},
+            {"do ", 45}, {"ara", 45}, {"al ", 44}, {" so", 44}, {"que", 44}, {" y ", 43}, {"por", 42},
+            {"par", 42}, {"ue ", 40}, {"nta", 40}, {"gra", 40}, {"ant", 39}, {"tar", 39}, {" se", 38},
+            {"con", 38}, {"men", 37}, {" qu", 37}, {"igr", 37}, {"mig", 37}, {"lic", 37}, {"tad", 36},
+            {"cia", 36}, {"oli", 34}, {"pro", 34}, {"sol", 34}, {"cit", 33}, {"ido", 33}, {"un ", 33},
+            {"na ", 33}, {"inm", 33}, {"ia ", 32}, {"nmi", 32}, {" lo", 31}, {"pre", 31}, {"io ", 30},
+            {"den", 30}, {"los", 29}, {"er ", 29}, {"ada", 29}, {"ta ", 29}, {"rac", 29}, {"una", 28},
+            {"ari", 28}, {"uni", 28}, {"so ", 28}, {"ien", 27}, {" pe", 27}, {"com", 27}, {"rio", 27},
+            {"nid", 27}, {"orm", 26}, {"nci", 26}, {"for", 26}, {" si", 26}, {" a ", 26}, {"da ", 26},
+            {"lar", 25}, {" po", 25}, {"se ", 24}, {"pue", 24}, {"enc", 24}, {"dad", 24}, {"to ", 24},
+            {" le", 24}, {"per", 24}, {"nto", 23}, {" ca", 23}
+        })
+    };
+    return profiles;
+}
+
+// Idioma más probable de un texto ya tokenizado. La confianza es el softmax
+// de las puntuaciones: 1/N si no hay ninguna pista, cerca de 1 si es claro.
+inline LanguageGuess guess_language(const TokenizedText& text) {
+    const auto& profiles = language_profiles();
+    std::vector<double> scores(profiles.size());
+    size_t best = 0;
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        scores[i] = profiles[i].score(text.tokens());
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+
+    double sum = 0.0;
+    for (double score : scores) {
+        sum += std::exp(score - scores[best]);
+    }
+
+    LanguageGuess guess;
+    guess.code = profiles[best].code();
+    guess.confidence = 1.0 / sum;
+    return guess;
+}
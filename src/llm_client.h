@@ -0,0 +1,551 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+#include "logging.h"
+#include "env_options.h"
+
+// Configuración del cliente de Ollama (ver README, sección Configuración)
+struct LlmClientOptions {
+    std::string url = "http://localhost:11434/api/generate";
+    std::string model = "llama3.2:1b";
+    long connect_timeout_ms = 2000;
+    long total_timeout_ms = 120000;
+    size_t max_concurrency = 4;     // Peticiones simultáneas a Ollama
+    size_t max_queued = 256;        // Peticiones en espera de un hueco, por carril
+
+    static LlmClientOptions from_env() {
+        LlmClientOptions options;
+        if (const char* env = std::getenv("OLLAMA_URL")) options.url = env;
+        if (const char* env = std::getenv("OLLAMA_MODEL")) options.model = env;
+        options.connect_timeout_ms = env_millis("OLLAMA_CONNECT_TIMEOUT_MS", options.connect_timeout_ms);
+        options.total_timeout_ms = env_millis("OLLAMA_TIMEOUT_MS", options.total_timeout_ms);
+        options.max_concurrency = env_count("OLLAMA_MAX_CONCURRENCY", options.max_concurrency);
+        options.max_queued = env_count("OLLAMA_MAX_QUEUED", options.max_queued);
+        if (options.max_concurrency == 0) options.max_concurrency = 1;
+        return options;
+    }
+};
+
+// Carriles de la cola: cuando queda un hueco se atiende primero el de mayor
+// prioridad, así un lote grande no retrasa a quien espera una respuesta
+enum class LlmPriority { INTERACTIVE = 0, BATCH = 1 };
+constexpr size_t LLM_PRIORITY_COUNT = 2;
+
+struct LlmResult {
+    bool ok = false;
+    std::string text;       // Concatenación de los campos "response"
+    std::string error;
+    long http_status = 0;
+    double elapsed_ms = 0.0;
+    size_t tokens = 0;      // Fragmentos recibidos (Ollama envía uno por token)
+    bool shared = false;    // Generación de otra petición con la misma coalesce_key
+    bool shed = false;      // Descartada por sobrecarga antes de llegar a Ollama
+    long retry_after_s = 0; // Con shed: segundos estimados hasta que haya hueco
+};
+
+struct LlmRequest {
+    std::string prompt;
+    double temperature = 0.1;
+    int max_tokens = 1000;
+
+    // Si no está vacía, una petición con la misma clave que ya está en cola o en
+    // curso no genera otra vez: se une a esa generación y recibe sus fragmentos
+    // (los ya llegados de golpe) y su resultado. Misma clave, mismo prompt.
+    std::string coalesce_key;
+
+    LlmPriority priority = LlmPriority::INTERACTIVE;
+    // Tiempo máximo en cola antes de empezar a generar (0 = sin límite). Si la
+    // espera estimada ya lo supera, se descarta al llegar en lugar de encolarla.
+    std::chrono::milliseconds max_queue_time{0};
+
+    // Opcionales; se llaman desde el hilo del cliente, así que no deben bloquear
+    std::function<void(const std::string&)> on_token;   // Cada fragmento según llega
+    std::function<void(const LlmResult&)> on_complete;  // Antes de resolver el future
+};
+
+struct LlmClientStats {
+    size_t in_flight = 0;
+    size_t queued = 0;
+    size_t queued_by_priority[LLM_PRIORITY_COUNT] = {};
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    uint64_t rejected = 0;      // Cliente no iniciado o detenido
+    uint64_t shed = 0;          // Cola llena o espera estimada demasiado larga
+    uint64_t expired = 0;       // Agotaron max_queue_time en la cola
+    uint64_t coalesced = 0;     // Peticiones servidas por la generación de otra
+    double avg_generation_ms = 0.0;
+};
+
+// Cliente asíncrono de Ollama sobre curl_multi. Un único hilo atiende todas
+// las transferencias, reutiliza las conexiones keep-alive y limita cuántas
+// peticiones hay en vuelo; el resto espera en cola. Cada llamada devuelve un
+// std::future, así que quien pregunta no ocupa un hilo mientras el modelo
+// genera. La respuesta NDJSON se procesa línea a línea a medida que llega.
+// Las peticiones con la misma coalesce_key comparten una única generación.
+//
+// Control de admisión: la cola tiene un carril por prioridad, cada uno con
+// max_queued plazas. Una petición con max_queue_time se descarta (shed) si al
+// llegar la espera estimada ya lo supera o si lo agota esperando; quien llama
+// responde entonces sin el modelo en vez de acumular retraso.
+class LlmClient {
+public:
+    LlmClient() = default;
+    ~LlmClient() { stop(); }
+
+    LlmClient(const LlmClient&) = delete;
+    LlmClient& operator=(const LlmClient&) = delete;
+
+    // Requiere curl_global_init previo
+    bool start(const LlmClientOptions& options) {
+        stop();
+
+        CURLM* multi = curl_multi_init();
+        if (!multi) {
+            log_error("No se pudo inicializar curl_multi");
+            return false;
+        }
+        curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(options.max_concurrency));
+        curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(options.max_concurrency));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_ = options;
+        multi_ = multi;
+        stopping_ = false;
+        thread_ = std::thread(&LlmClient::run, this);
+        return true;
+    }
+
+    // Cancela lo pendiente (las promesas se resuelven con error) y detiene el hilo
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!thread_.joinable()) {
+                return;
+            }
+            stopping_ = true;
+        }
+        curl_multi_wakeup(multi_);
+        thread_.join();
+
+        curl_multi_cleanup(multi_);
+        multi_ = nullptr;
+    }
+
+    std::future<LlmResult> generate(LlmRequest request) {
+        const auto now = std::chrono::steady_clock::now();
+        auto transfer = std::make_unique<Transfer>();
+        transfer->lane = static_cast<size_t>(request.priority);
+        transfer->deadline = request.max_queue_time.count() > 0 ? now + request.max_queue_time : NO_DEADLINE;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!request.coalesce_key.empty()) {
+            auto it = coalescing_.find(request.coalesce_key);
+            if (it != coalescing_.end()) {
+                return join(*it->second, std::move(request), *transfer, lock);
+            }
+        }
+
+        transfer->request = std::move(request);
+        std::future<LlmResult> future = transfer->promise.get_future();
+        const long expected_wait_ms = expected_wait_ms_locked(transfer->lane);
+
+        if (!thread_.joinable() || stopping_) {
+            transfer->result.error = "cliente de Ollama no iniciado";
+            rejected_++;
+        } else if (pending_[transfer->lane].size() >= options_.max_queued) {
+            shed(*transfer, "cola de Ollama llena", expected_wait_ms);
+        } else if (transfer->deadline != NO_DEADLINE && now + std::chrono::milliseconds(expected_wait_ms) > transfer->deadline) {
+            shed(*transfer, "Ollama saturado: espera estimada de " + std::to_string(expected_wait_ms) + " ms", expected_wait_ms);
+        } else {
+            if (!transfer->request.coalesce_key.empty()) {
+                coalescing_[transfer->request.coalesce_key] = transfer.get();
+            }
+            pending_[transfer->lane].push_back(std::move(transfer));
+            CURLM* multi = multi_;
+            lock.unlock();
+            curl_multi_wakeup(multi);
+            return future;
+        }
+
+        lock.unlock();
+        complete(*transfer);
+        return future;
+    }
+
+    LlmClientStats stats() const {
+        LlmClientStats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t lane = 0; lane < LLM_PRIORITY_COUNT; ++lane) {
+                stats.queued_by_priority[lane] = pending_[lane].size();
+                stats.queued += pending_[lane].size();
+            }
+        }
+        stats.in_flight = in_flight_.load();
+        stats.completed = completed_.load();
+        stats.failed = failed_.load();
+        stats.rejected = rejected_.load();
+        stats.shed = shed_.load();
+        stats.expired = expired_.load();
+        stats.coalesced = coalesced_.load();
+        stats.avg_generation_ms = avg_generation_us_.load() / 1000.0;
+        return stats;
+    }
+
+private:
+    static constexpr std::chrono::steady_clock::time_point NO_DEADLINE = std::chrono::steady_clock::time_point::max();
+
+    struct Follower {
+        LlmRequest request;
+        std::promise<LlmResult> promise;
+    };
+
+    struct Transfer {
+        LlmRequest request;
+        std::string body;
+        std::string line_buffer;
+        LlmResult result;
+        std::promise<LlmResult> promise;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point deadline = NO_DEADLINE;   // Para empezar a generar
+        size_t lane = 0;
+        bool dequeued = false;      // Ya salió de la cola (protegido por mutex_)
+        CURL* easy = nullptr;
+        curl_slist* headers = nullptr;
+
+        // Peticiones unidas a esta generación. El lock también protege
+        // result.text, que se lee al unirse para reenviar lo ya generado.
+        std::mutex followers_mutex;
+        std::vector<Follower> followers;
+    };
+
+    // Se llama con mutex_ tomado; se suelta antes de reenviar los fragmentos, pero
+    // con followers_mutex ya tomado para que ninguno llegue antes que ellos.
+    // Si la generación aún está en cola, hereda la prioridad y el plazo más
+    // generosos de quien se une (candidate solo aporta esos dos datos).
+    std::future<LlmResult> join(Transfer& transfer, LlmRequest request, const Transfer& candidate,
+                                std::unique_lock<std::mutex>& lock) {
+        if (!transfer.dequeued) {
+            transfer.deadline = std::max(transfer.deadline, candidate.deadline);
+            if (candidate.lane < transfer.lane) {
+                auto& from = pending_[transfer.lane];
+                auto it = std::find_if(from.begin(), from.end(), [&](const auto& queued) { return queued.get() == &transfer; });
+                pending_[candidate.lane].push_back(std::move(*it));
+                from.erase(it);
+                transfer.lane = candidate.lane;
+            }
+        }
+
+        std::lock_guard<std::mutex> followers_lock(transfer.followers_mutex);
+        lock.unlock();
+        coalesced_++;
+
+        if (request.on_token && !transfer.result.text.empty()) {
+            request.on_token(transfer.result.text);
+        }
+        transfer.followers.push_back({std::move(request), std::promise<LlmResult>()});
+        return transfer.followers.back().promise.get_future();
+    }
+
+    // Cuánto esperaría una petición nueva de este carril: las que van delante
+    // (su carril y los más prioritarios) más las que ocupan los huecos, a
+    // max_concurrency por tanda y con la duración media de una generación
+    long expected_wait_ms_locked(size_t lane) const {
+        size_t ahead = in_flight_.load();
+        for (size_t l = 0; l <= lane; ++l) {
+            ahead += pending_[l].size();
+        }
+        const size_t rounds = ahead / std::max<size_t>(1, options_.max_concurrency);
+        return static_cast<long>(rounds * avg_generation_us_.load() / 1000);
+    }
+
+    void shed(Transfer& transfer, const std::string& reason, long expected_wait_ms) {
+        transfer.result.error = reason;
+        transfer.result.shed = true;
+        transfer.result.retry_after_s = std::max(1L, (expected_wait_ms + 999) / 1000);
+        shed_++;
+    }
+
+    static size_t on_data(char* contents, size_t size, size_t nmemb, void* userp) {
+        auto* transfer = static_cast<Transfer*>(userp);
+        const size_t total = size * nmemb;
+        transfer->line_buffer.append(contents, total);
+
+        // Procesar cada línea NDJSON completa en cuanto llega
+        size_t start = 0;
+        size_t newline;
+        while ((newline = transfer->line_buffer.find('\n', start)) != std::string::npos) {
+            parse_line(*transfer, transfer->line_buffer.substr(start, newline - start));
+            start = newline + 1;
+        }
+        transfer->line_buffer.erase(0, start);
+        return total;
+    }
+
+    static void parse_line(Transfer& transfer, const std::string& line) {
+        if (line.empty()) {
+            return;
+        }
+        try {
+            auto line_json = nlohmann::json::parse(line);
+            if (line_json.contains("response") && line_json["response"].is_string()) {
+                const std::string& token = line_json["response"].get_ref<const std::string&>();
+                std::lock_guard<std::mutex> lock(transfer.followers_mutex);
+                transfer.result.text += token;
+                if (!token.empty()) {
+                    transfer.result.tokens++;
+                    if (transfer.request.on_token) {
+                        transfer.request.on_token(token);
+                    }
+                    for (auto& follower : transfer.followers) {
+                        if (follower.request.on_token) {
+                            follower.request.on_token(token);
+                        }
+                    }
+                }
+            }
+            if (line_json.contains("error") && line_json["error"].is_string()) {
+                transfer.result.error = line_json["error"].get<std::string>();
+            }
+        } catch (const std::exception& e) {
+            log_error("Error al procesar línea JSON: " + std::string(e.what()) + " - Línea: " + line);
+        }
+    }
+
+    void begin(std::unique_ptr<Transfer> transfer) {
+        Transfer* t = transfer.get();
+        nlohmann::json request_json = {
+            {"model", options_.model},
+            {"prompt", t->request.prompt},
+            {"options", {
+                {"temperature", t->request.temperature},
+                {"num_predict", t->request.max_tokens}
+            }}
+        };
+        t->body = request_json.dump();
+        t->started = std::chrono::steady_clock::now();
+
+        t->easy = curl_easy_init();
+        if (!t->easy) {
+            t->result.error = "curl_easy_init falló";
+            finish(std::move(transfer));
+            return;
+        }
+
+        t->headers = curl_slist_append(nullptr, "Content-Type: application/json");
+        curl_easy_setopt(t->easy, CURLOPT_URL, options_.url.c_str());
+        curl_easy_setopt(t->easy, CURLOPT_HTTPHEADER, t->headers);
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDS, t->body.c_str());
+        curl_easy_setopt(t->easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(t->body.size()));
+        curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, on_data);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, t);
+        curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t);
+        curl_easy_setopt(t->easy, CURLOPT_CONNECTTIMEOUT_MS, options_.connect_timeout_ms);
+        curl_easy_setopt(t->easy, CURLOPT_TIMEOUT_MS, options_.total_timeout_ms);
+        curl_easy_setopt(t->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(t->easy, CURLOPT_NOSIGNAL, 1L);
+
+        curl_multi_add_handle(multi_, t->easy);
+        active_.push_back(std::move(transfer));
+        in_flight_++;
+    }
+
+    void finish(std::unique_ptr<Transfer> transfer) {
+        Transfer* t = transfer.get();
+        if (!t->line_buffer.empty()) {
+            parse_line(*t, t->line_buffer);
+            t->line_buffer.clear();
+        }
+        if (t->easy) {
+            curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE, &t->result.http_status);
+            curl_multi_remove_handle(multi_, t->easy);
+            curl_easy_cleanup(t->easy);
+            t->easy = nullptr;
+        }
+        curl_slist_free_all(t->headers);
+        t->headers = nullptr;
+
+        if (t->result.error.empty() && t->result.http_status >= 400) {
+            t->result.error = "HTTP " + std::to_string(t->result.http_status);
+        }
+        t->result.ok = t->result.error.empty();
+        t->result.elapsed_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t->started).count();
+
+        if (t->result.ok) {
+            completed_++;
+            // Media móvil (1/8) de lo que tarda una generación, para estimar esperas
+            const auto sample_us = static_cast<uint64_t>(t->result.elapsed_ms * 1000.0);
+            const uint64_t average_us = avg_generation_us_.load();
+            avg_generation_us_ = average_us == 0 ? sample_us : average_us - average_us / 8 + sample_us / 8;
+        } else {
+            failed_++;
+        }
+        complete(*t);
+    }
+
+    void complete(Transfer& transfer) {
+        // Desde aquí las peticiones con la misma clave empiezan una generación nueva
+        std::vector<Follower> followers;
+        if (!transfer.request.coalesce_key.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = coalescing_.find(transfer.request.coalesce_key);
+                if (it != coalescing_.end() && it->second == &transfer) {
+                    coalescing_.erase(it);
+                }
+            }
+            std::lock_guard<std::mutex> lock(transfer.followers_mutex);
+            followers.swap(transfer.followers);
+        }
+
+        if (transfer.request.on_complete) {
+            transfer.request.on_complete(transfer.result);
+        }
+        for (auto& follower : followers) {
+            LlmResult result = transfer.result;
+            result.shared = true;
+            if (follower.request.on_complete) {
+                follower.request.on_complete(result);
+            }
+            follower.promise.set_value(std::move(result));
+        }
+        transfer.promise.set_value(std::move(transfer.result));
+    }
+
+    void run() {
+        while (true) {
+            std::vector<std::unique_ptr<Transfer>> cancelled;
+            std::vector<std::unique_ptr<Transfer>> starting;
+            std::vector<std::unique_ptr<Transfer>> expired;
+            long long expired_wait_ms = 0;
+            auto poll_timeout = std::chrono::milliseconds(1000);
+            bool stopping = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const auto now = std::chrono::steady_clock::now();
+                for (auto& lane : pending_) {
+                    if (stopping_) {
+                        std::move(lane.begin(), lane.end(), std::back_inserter(cancelled));
+                        lane.clear();
+                        continue;
+                    }
+                    // Las que agotaron su plazo salen sin llegar a Ollama; para
+                    // las demás, despertar a tiempo de revisar el suyo
+                    auto keep = std::stable_partition(lane.begin(), lane.end(), [&](const auto& transfer) {
+                        return transfer->deadline > now;
+                    });
+                    for (auto it = keep; it != lane.end(); ++it) {
+                        (*it)->dequeued = true;
+                        expired.push_back(std::move(*it));
+                    }
+                    lane.erase(keep, lane.end());
+                    for (const auto& transfer : lane) {
+                        if (transfer->deadline != NO_DEADLINE) {
+                            poll_timeout = std::min(poll_timeout, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                transfer->deadline - now) + std::chrono::milliseconds(1));
+                        }
+                    }
+                }
+                stopping = stopping_;
+                if (!expired.empty()) {
+                    expired_wait_ms = expected_wait_ms_locked(LLM_PRIORITY_COUNT - 1);
+                }
+                for (auto& lane : pending_) {
+                    while (!stopping_ && !lane.empty() && active_.size() + starting.size() < options_.max_concurrency) {
+                        lane.front()->dequeued = true;
+                        starting.push_back(std::move(lane.front()));
+                        lane.pop_front();
+                    }
+                }
+            }
+            // Fuera del lock: si begin() falla, complete() necesita tomarlo
+            for (auto& transfer : starting) {
+                begin(std::move(transfer));
+            }
+            for (auto& transfer : expired) {
+                expired_++;
+                shed(*transfer, "tiempo máximo en la cola de Ollama agotado", static_cast<long>(expired_wait_ms));
+                complete(*transfer);
+            }
+
+            if (stopping) {
+                for (auto& transfer : cancelled) {
+                    transfer->result.error = "cliente de Ollama detenido";
+                    complete(*transfer);
+                }
+                for (auto& transfer : active_) {
+                    transfer->result.error = "cliente de Ollama detenido";
+                    in_flight_--;
+                    finish(std::move(transfer));
+                }
+                active_.clear();
+                return;
+            }
+
+            int running = 0;
+            curl_multi_perform(multi_, &running);
+
+            CURLMsg* msg;
+            int remaining = 0;
+            while ((msg = curl_multi_info_read(multi_, &remaining))) {
+                if (msg->msg != CURLMSG_DONE) continue;
+
+                Transfer* done = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &done);
+                if (msg->data.result != CURLE_OK) {
+                    done->result.error = curl_easy_strerror(msg->data.result);
+                }
+
+                for (auto it = active_.begin(); it != active_.end(); ++it) {
+                    if (it->get() == done) {
+                        auto transfer = std::move(*it);
+                        active_.erase(it);
+                        in_flight_--;
+                        finish(std::move(transfer));
+                        break;
+                    }
+                }
+            }
+
+            // Espera hasta que haya datos, venza un timeout o llegue curl_multi_wakeup
+            curl_multi_poll(multi_, nullptr, 0, static_cast<int>(std::max<long long>(0, poll_timeout.count())), nullptr);
+        }
+    }
+
+    LlmClientOptions options_;
+    CURLM* multi_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::deque<std::unique_ptr<Transfer>> pending_[LLM_PRIORITY_COUNT];
+    std::unordered_map<std::string, Transfer*> coalescing_;    // Por coalesce_key, en cola o en curso
+    std::thread thread_;
+    bool stopping_ = false;
+
+    // Solo lo usa el hilo de curl
+    std::vector<std::unique_ptr<Transfer>> active_;
+
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> shed_{0};
+    std::atomic<uint64_t> expired_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> avg_generation_us_{0};    // Solo la escribe el hilo de curl
+};
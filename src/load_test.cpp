@@ -0,0 +1,621 @@
+// Prueba de carga de /chatbot: reproduce las preguntas del dataset (y
+// paráfrasis de ellas) contra el servidor por HTTP o, con --in-process,
+// directamente contra Engine::answer() en el mismo proceso. Mide rendimiento
+// y latencias p50/p99/p999 por nivel (el que dio la respuesta) con un Ollama
+// simulado local para que las ejecuciones no dependan de un modelo real ni de
+// la red.
+//
+// Carga cerrada (--concurrency N): N clientes que envían la siguiente
+// pregunta en cuanto reciben la respuesta.
+// Carga abierta (--rate R): llegadas de Poisson a R pet/s repartidas entre los
+// clientes; la latencia se mide desde el instante previsto de llegada, así que
+// incluye la espera si el servicio (o el cliente) se queda atrás.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <unistd.h>
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+#include "engine.h"
+#include "mock_ollama.h"
+#include "logging.h"
+
+namespace load_test {
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string url;                // http://host:puerto del servidor; vacío en proceso
+    bool in_process = false;
+    size_t concurrency = 16;
+    double rate = 0.0;              // pet/s en carga abierta; 0 = carga cerrada
+    double duration_s = 10.0;
+    double warmup_s = 2.0;
+    size_t paraphrases = 3;         // Paráfrasis por pregunta del dataset
+    double zipf = 1.0;              // Sesgo de popularidad (0 = uniforme)
+    uint64_t seed = 42;
+    long timeout_ms = 30000;
+    std::vector<std::string> datasets;
+    std::string json_path;          // Informe en JSON además del texto
+    size_t print_questions = 0;     // Solo escribir esta cantidad de preguntas del corpus
+    bool mock = false;              // Ollama simulado (siempre en proceso salvo --no-mock)
+    bool no_mock = false;
+    uint16_t mock_port = 0;
+    MockOllamaOptions mock_options;
+};
+
+// Resultado de una petición
+struct Sample {
+    uint32_t latency_us;
+    uint8_t tier;                   // Tier (índice en TIER_NAMES); TIER_COUNT si no se conoce
+    bool degraded;
+};
+
+// ---------------------------------------------------------------------------
+// Corpus de preguntas
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Preguntas de los JSON del dataset ({"categoría": [{"question": ...}]}),
+// sin el prefijo "**Pregunta**:" ni duplicados
+std::vector<std::string> load_questions(const std::vector<std::string>& paths) {
+    std::vector<std::string> questions;
+    for (const auto& path : paths) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            log_error("No se pudo abrir el archivo en la ruta: " + path);
+            continue;
+        }
+        json root = json::parse(file, nullptr, false);
+        if (!root.is_object()) {
+            log_error("JSON no válido: " + path);
+            continue;
+        }
+        for (const auto& category : root.items()) {
+            if (!category.value().is_array()) continue;
+            for (const auto& entry : category.value()) {
+                if (!entry.is_object() || !entry.contains("question") || !entry["question"].is_string()) continue;
+                std::string question = entry["question"].get<std::string>();
+                const std::string prefix = "**Pregunta**:";
+                if (question.compare(0, prefix.size(), prefix) == 0) {
+                    question.erase(0, prefix.size());
+                }
+                question.erase(0, question.find_first_not_of(" \t\n"));
+                if (!question.empty()) {
+                    questions.push_back(question);
+                }
+            }
+        }
+        log_info(path + ": " + std::to_string(questions.size()) + " preguntas acumuladas");
+    }
+    std::sort(questions.begin(), questions.end());
+    questions.erase(std::unique(questions.begin(), questions.end()), questions.end());
+    return questions;
+}
+
+void replace_all(std::string& text, const std::string& from, const std::string& to) {
+    for (size_t pos = 0; (pos = text.find(from, pos)) != std::string::npos; pos += to.size()) {
+        text.replace(pos, from.size(), to);
+    }
+}
+
+// Una variación de la pregunta como la escribiría otro usuario. Algunas solo
+// cambian lo que la normalización ya ignora (mayúsculas, tildes, signos) y
+// deben acertar en la caché; otras añaden palabras y obligan a buscar.
+std::string paraphrase(const std::string& question, uint64_t seed) {
+    static const char* const PREFIXES[] = {"Hola, ", "Por favor, ", "Quisiera saber: ", "Una consulta: ", "Buenas. "};
+    static const char* const SUFFIXES[] = {" Gracias.", " por favor", " Es urgente.", " ¿Me pueden ayudar?"};
+    static const char* const ACCENTS[][2] = {{"á", "a"}, {"é", "e"}, {"í", "i"}, {"ó", "o"}, {"ú", "u"},
+                                             {"Á", "A"}, {"É", "E"}, {"Í", "I"}, {"Ó", "O"}, {"Ú", "U"}};
+    std::string text = question;
+    const size_t mutations = 1 + seed % 2;
+    for (size_t m = 0; m < mutations; ++m) {
+        seed = splitmix64(seed);
+        switch (seed % 6) {
+            case 0:
+                std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+                    return c < 0x80 ? static_cast<char>(std::tolower(c)) : static_cast<char>(c);
+                });
+                break;
+            case 1:
+                replace_all(text, "¿", "");
+                replace_all(text, "?", "");
+                break;
+            case 2:
+                for (const auto& accent : ACCENTS) replace_all(text, accent[0], accent[1]);
+                break;
+            case 3:
+                text = PREFIXES[(seed >> 8) % 5] + text;
+                break;
+            case 4:
+                text += SUFFIXES[(seed >> 8) % 4];
+                break;
+            default:
+                replace_all(text, "Estados Unidos", "EE. UU.");
+                replace_all(text, "EE.UU.", "Estados Unidos");
+                break;
+        }
+    }
+    return text;
+}
+
+// Preguntas con su probabilidad acumulada (Zipf sobre un orden aleatorio)
+struct Corpus {
+    std::vector<std::string> questions;
+    std::vector<double> cdf;
+    
+    const std::string& pick(uint64_t random) const {
+        const double u = (random >> 11) * (1.0 / 9007199254740992.0);
+        size_t index = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return questions[std::min(index, questions.size() - 1)];
+    }
+};
+
+Corpus build_corpus(const std::vector<std::string>& base, const Options& options) {
+    Corpus corpus;
+    for (size_t i = 0; i < base.size(); ++i) {
+        corpus.questions.push_back(base[i]);
+        for (size_t p = 0; p < options.paraphrases; ++p) {
+            corpus.questions.push_back(paraphrase(base[i], splitmix64(options.seed ^ (i * 131 + p))));
+        }
+    }
+    std::shuffle(corpus.questions.begin(), corpus.questions.end(), std::mt19937_64(options.seed));
+    
+    double total = 0.0;
+    for (size_t rank = 0; rank < corpus.questions.size(); ++rank) {
+        total += 1.0 / std::pow(rank + 1.0, options.zipf);
+        corpus.cdf.push_back(total);
+    }
+    for (double& value : corpus.cdf) {
+        value /= total;
+    }
+    return corpus;
+}
+
+// ---------------------------------------------------------------------------
+// Destinos: HTTP o en proceso
+
+size_t append_body(char* data, size_t size, size_t count, void* out) {
+    static_cast<std::string*>(out)->append(data, size * count);
+    return size * count;
+}
+
+// Un cliente HTTP por hilo, con la conexión reutilizada entre peticiones
+class HttpTarget {
+public:
+    HttpTarget(const std::string& url, long timeout_ms) : url_(url + "/chatbot") {
+        curl_ = curl_easy_init();
+        headers_ = curl_slist_append(nullptr, "Content-Type: application/json");
+        curl_easy_setopt(curl_, CURLOPT_URL, url_.c_str());
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers_);
+        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, append_body);
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &body_);
+        curl_easy_setopt(curl_, CURLOPT_TIMEOUT_MS, timeout_ms);
+        curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl_, CURLOPT_TCP_NODELAY, 1L);
+    }
+    
+    ~HttpTarget() {
+        curl_slist_free_all(headers_);
+        curl_easy_cleanup(curl_);
+    }
+    
+    HttpTarget(const HttpTarget&) = delete;
+    HttpTarget& operator=(const HttpTarget&) = delete;
+    
+    // false si la petición falló; source queda vacío si la respuesta no lo trae
+    bool ask(const std::string& question, std::string& source, bool& degraded) {
+        const std::string request = json{{"question", question}}.dump();
+        body_.clear();
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, request.c_str());
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.size()));
+        CURLcode code = curl_easy_perform(curl_);
+        long status = 0;
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &status);
+        if (code != CURLE_OK || status != 200) {
+            if (errors_logged_++ < 3) {
+                log_error("Petición fallida: " + std::string(curl_easy_strerror(code)) + ", HTTP " +
+                          std::to_string(status));
+            }
+            return false;
+        }
+        json response = json::parse(body_, nullptr, false);
+        if (!response.is_object() || !response.contains("response")) {
+            return false;
+        }
+        source = response.value("source", "");
+        degraded = response.value("degraded", false);
+        return true;
+    }
+
+private:
+    std::string url_;
+    CURL* curl_ = nullptr;
+    curl_slist* headers_ = nullptr;
+    std::string body_;
+    size_t errors_logged_ = 0;
+};
+
+bool ask_in_process(Engine& engine, const std::string& question, std::string& source, bool& degraded) {
+    QueryAnswer answer = engine.answer(question);
+    source = answer.source;
+    degraded = answer.degraded;
+    return !answer.response.empty();
+}
+
+uint8_t tier_index(const std::string& source) {
+    for (int i = 0; i < TIER_COUNT; ++i) {
+        if (source == TIER_NAMES[i]) return static_cast<uint8_t>(i);
+    }
+    return static_cast<uint8_t>(TIER_COUNT);
+}
+
+// ---------------------------------------------------------------------------
+// Generación de carga
+
+struct WorkerResult {
+    std::vector<Sample> samples;
+    uint64_t errors = 0;
+    uint64_t max_send_lag_us = 0;   // Carga abierta: retraso sobre la llegada prevista
+    Clock::time_point last_completion;
+};
+
+struct Run {
+    std::vector<WorkerResult> workers;
+    double measured_s = 0.0;
+};
+
+// engine: el motor en proceso, o nullptr para probar por HTTP
+Run run_load(const Options& options, const Corpus& corpus, Engine* engine) {
+    const auto start = Clock::now();
+    const auto measure_from = start + std::chrono::duration_cast<Clock::duration>(
+                                          std::chrono::duration<double>(options.warmup_s));
+    const auto end = measure_from + std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<double>(options.duration_s));
+    
+    // Carga abierta: instantes de llegada (Poisson) calculados de antemano
+    std::vector<Clock::duration> arrivals;
+    if (options.rate > 0) {
+        std::mt19937_64 rng(options.seed);
+        std::exponential_distribution<double> gap(options.rate);
+        double t = 0.0;
+        const double total_s = options.warmup_s + options.duration_s;
+        while ((t += gap(rng)) < total_s) {
+            arrivals.push_back(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(t)));
+        }
+    }
+    
+    Run run;
+    run.workers.resize(options.concurrency);
+    std::atomic<uint64_t> next{0};
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < options.concurrency; ++w) {
+        threads.emplace_back([&, w] {
+            WorkerResult& result = run.workers[w];
+            std::unique_ptr<HttpTarget> http;
+            if (!engine) {
+                http.reset(new HttpTarget(options.url, options.timeout_ms));
+            }
+            while (true) {
+                const uint64_t i = next++;
+                Clock::time_point scheduled;
+                if (options.rate > 0) {
+                    if (i >= arrivals.size()) break;
+                    scheduled = start + arrivals[i];
+                    std::this_thread::sleep_until(scheduled);
+                    const auto lag = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduled);
+                    result.max_send_lag_us = std::max<uint64_t>(result.max_send_lag_us, lag.count());
+                } else {
+                    scheduled = Clock::now();
+                    if (scheduled >= end) break;
+                }
+                
+                // La pregunta depende solo de la semilla y del número de petición
+                const std::string& question = corpus.pick(splitmix64(options.seed + i));
+                std::string source;
+                bool degraded = false;
+                bool ok = http ? http->ask(question, source, degraded) : ask_in_process(*engine, question, source, degraded);
+                const auto done = Clock::now();
+                if (scheduled < measure_from) {
+                    continue;
+                }
+                if (!ok) {
+                    result.errors++;
+                    continue;
+                }
+                const auto us = std::chrono::duration_cast<std::chrono::microseconds>(done - scheduled).count();
+                result.samples.push_back({static_cast<uint32_t>(std::min<int64_t>(us, UINT32_MAX)),
+                                          tier_index(source), degraded});
+                result.last_completion = std::max(result.last_completion, done);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    Clock::time_point last = measure_from;
+    for (const auto& worker : run.workers) {
+        last = std::max(last, worker.last_completion);
+    }
+    run.measured_s = std::chrono::duration<double>(last - measure_from).count();
+    return run;
+}
+
+// ---------------------------------------------------------------------------
+// Informe
+
+struct Row {
+    std::string name;
+    size_t count = 0;
+    double p50_ms = 0, p99_ms = 0, p999_ms = 0, max_ms = 0;
+};
+
+// Percentil por rango más cercano sobre latencias ordenadas
+double percentile_ms(const std::vector<uint32_t>& sorted_us, double q) {
+    if (sorted_us.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(q * sorted_us.size()));
+    return sorted_us[std::min(sorted_us.size(), std::max<size_t>(rank, 1)) - 1] / 1000.0;
+}
+
+Row make_row(const std::string& name, std::vector<uint32_t> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    Row row;
+    row.name = name;
+    row.count = latencies.size();
+    row.p50_ms = percentile_ms(latencies, 0.50);
+    row.p99_ms = percentile_ms(latencies, 0.99);
+    row.p999_ms = percentile_ms(latencies, 0.999);
+    row.max_ms = latencies.empty() ? 0.0 : latencies.back() / 1000.0;
+    return row;
+}
+
+void report(const Options& options, const Corpus& corpus, const Run& run, uint64_t mock_generations) {
+    std::vector<uint32_t> all;
+    std::vector<std::vector<uint32_t>> by_tier(TIER_COUNT + 1);
+    uint64_t errors = 0, degraded = 0, max_lag_us = 0;
+    for (const auto& worker : run.workers) {
+        errors += worker.errors;
+        max_lag_us = std::max(max_lag_us, worker.max_send_lag_us);
+        for (const auto& sample : worker.samples) {
+            all.push_back(sample.latency_us);
+            by_tier[sample.tier].push_back(sample.latency_us);
+            degraded += sample.degraded;
+        }
+    }
+    
+    std::vector<Row> rows;
+    rows.push_back(make_row("total", all));
+    for (int i = 0; i <= TIER_COUNT; ++i) {
+        if (!by_tier[i].empty()) {
+            rows.push_back(make_row(i < TIER_COUNT ? TIER_NAMES[i] : "desconocido", by_tier[i]));
+        }
+    }
+    const double throughput = run.measured_s > 0 ? all.size() / run.measured_s : 0.0;
+    
+    log_flush();
+    char line[160];
+    if (options.rate > 0) {
+        std::printf("Carga abierta: %.1f pet/s (Poisson), hasta %zu en curso", options.rate, options.concurrency);
+    } else {
+        std::printf("Carga cerrada: %zu clientes", options.concurrency);
+    }
+    std::printf(", %.1f s (+%.1f s de calentamiento), %zu preguntas distintas, %s\n", options.duration_s,
+                options.warmup_s, corpus.questions.size(), options.in_process ? "en proceso" : options.url.c_str());
+    std::printf("Completadas: %zu (%llu errores, %llu degradadas) en %.2f s -> %.1f pet/s\n", all.size(),
+                static_cast<unsigned long long>(errors), static_cast<unsigned long long>(degraded), run.measured_s,
+                throughput);
+    if (options.rate > 0) {
+        std::printf("Retraso máximo de envío: %.1f ms%s\n", max_lag_us / 1000.0,
+                    max_lag_us > 10000 ? " (el cliente no llegó a tiempo; subir --concurrency)" : "");
+    }
+    if (options.mock || (options.in_process && !options.no_mock)) {
+        std::printf("Generaciones del Ollama simulado: %llu\n", static_cast<unsigned long long>(mock_generations));
+    }
+    std::printf("\n%-16s %10s %10s %10s %10s %10s\n", "nivel", "peticiones", "p50 ms", "p99 ms", "p999 ms", "máx ms");
+    for (const auto& row : rows) {
+        std::snprintf(line, sizeof(line), "%-16s %10zu %10.2f %10.2f %10.2f %10.2f", row.name.c_str(), row.count,
+                      row.p50_ms, row.p99_ms, row.p999_ms, row.max_ms);
+        std::printf("%s\n", line);
+    }
+    std::fflush(stdout);
+    
+    if (!options.json_path.empty()) {
+        json out = {
+            {"mode", options.rate > 0 ? "open" : "closed"},
+            {"rate", options.rate},
+            {"concurrency", options.concurrency},
+            {"duration_s", options.duration_s},
+            {"warmup_s", options.warmup_s},
+            {"seed", options.seed},
+            {"questions", corpus.questions.size()},
+            {"target", options.in_process ? "in-process" : options.url},
+            {"completed", all.size()},
+            {"errors", errors},
+            {"degraded", degraded},
+            {"throughput_rps", throughput},
+            {"max_send_lag_ms", max_lag_us / 1000.0},
+            {"mock_generations", mock_generations},
+            {"tiers", json::object()}
+        };
+        for (const auto& row : rows) {
+            out["tiers"][row.name] = {{"count", row.count}, {"p50_ms", row.p50_ms}, {"p99_ms", row.p99_ms},
+                                      {"p999_ms", row.p999_ms}, {"max_ms", row.max_ms}};
+        }
+        std::ofstream file(options.json_path);
+        file << out.dump(2) << std::endl;
+        if (!file) {
+            log_error("No se pudo escribir el informe en " + options.json_path);
+        }
+    }
+}
+
+void usage(const char* program) {
+    log_flush();
+    std::cout << "Uso: " << program << " (--url http://host:puerto | --in-process) [opciones] [dataset.json...]\n"
+              << "  --concurrency N       Clientes simultáneos (carga cerrada) o máximo en curso (abierta) (16)\n"
+              << "  --rate R              Carga abierta: llegadas de Poisson a R pet/s\n"
+              << "  --duration S          Segundos medidos (10)\n"
+              << "  --warmup S            Segundos iniciales que no se miden (2)\n"
+              << "  --paraphrases N       Paráfrasis por pregunta del dataset (3)\n"
+              << "  --zipf S              Sesgo de popularidad de las preguntas, 0 = uniforme (1.0)\n"
+              << "  --seed N              Semilla de preguntas y llegadas (42)\n"
+              << "  --timeout-ms N        Tiempo máximo por petición HTTP (30000)\n"
+              << "  --json FICHERO        Guarda también el informe en JSON\n"
+              << "  --print-questions N   Solo escribe N preguntas del corpus, una por línea\n"
+              << "  --mock-ollama PUERTO  Arranca un Ollama simulado (HTTP: el servidor debe usar\n"
+              << "                        OLLAMA_URL=http://127.0.0.1:PUERTO/api/generate)\n"
+              << "  --no-mock             En proceso, usar OLLAMA_URL en lugar del Ollama simulado\n"
+              << "  --mock-first-token-ms N, --mock-token-ms N, --mock-tokens N\n"
+              << "                        Tiempos del Ollama simulado (50, 10, 40)\n"
+              << "Sin dataset se usan ../dataset/nolivos_immigration_ai_extended.json y "
+                 "../dataset/nolivos_immigration_qa.json." << std::endl;
+}
+
+// false si faltan valores o son incorrectos
+bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](double& out) {
+            if (i + 1 >= argc) return false;
+            char* end = nullptr;
+            out = std::strtod(argv[++i], &end);
+            return *end == '\0';
+        };
+        double number = 0.0;
+        if (arg == "--url" && i + 1 < argc) {
+            options.url = argv[++i];
+            while (!options.url.empty() && options.url.back() == '/') options.url.pop_back();
+        } else if (arg == "--in-process") {
+            options.in_process = true;
+        } else if (arg == "--no-mock") {
+            options.no_mock = true;
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.json_path = argv[++i];
+        } else if (arg == "--concurrency" && value(number) && number >= 1) {
+            options.concurrency = static_cast<size_t>(number);
+        } else if (arg == "--rate" && value(number) && number >= 0) {
+            options.rate = number;
+        } else if (arg == "--duration" && value(number) && number > 0) {
+            options.duration_s = number;
+        } else if (arg == "--warmup" && value(number) && number >= 0) {
+            options.warmup_s = number;
+        } else if (arg == "--paraphrases" && value(number) && number >= 0) {
+            options.paraphrases = static_cast<size_t>(number);
+        } else if (arg == "--zipf" && value(number) && number >= 0) {
+            options.zipf = number;
+        } else if (arg == "--seed" && value(number)) {
+            options.seed = static_cast<uint64_t>(number);
+        } else if (arg == "--timeout-ms" && value(number) && number > 0) {
+            options.timeout_ms = static_cast<long>(number);
+        } else if (arg == "--print-questions" && value(number) && number >= 1) {
+            options.print_questions = static_cast<size_t>(number);
+        } else if (arg == "--mock-ollama" && value(number) && number > 0 && number < 65536) {
+            options.mock = true;
+            options.mock_port = static_cast<uint16_t>(number);
+        } else if (arg == "--mock-first-token-ms" && value(number) && number >= 0) {
+            options.mock_options.first_token_delay = std::chrono::milliseconds(static_cast<long>(number));
+        } else if (arg == "--mock-token-ms" && value(number) && number >= 0) {
+            options.mock_options.token_interval = std::chrono::milliseconds(static_cast<long>(number));
+        } else if (arg == "--mock-tokens" && value(number) && number >= 1) {
+            options.mock_options.tokens = static_cast<size_t>(number);
+        } else if (arg.compare(0, 2, "--") != 0) {
+            options.datasets.push_back(arg);
+        } else {
+            log_error("Opción desconocida o valor no válido: " + arg);
+            return false;
+        }
+    }
+    if (options.print_questions == 0 && options.in_process == !options.url.empty()) {
+        log_error("Indicar exactamente uno de --url o --in-process");
+        return false;
+    }
+    if (options.datasets.empty()) {
+        options.datasets = {"../dataset/nolivos_immigration_ai_extended.json", "../dataset/nolivos_immigration_qa.json"};
+    }
+    return true;
+}
+
+} // namespace load_test
+
+int main(int argc, char* argv[]) {
+    using namespace load_test;
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+    
+    std::vector<std::string> base = load_questions(options.datasets);
+    if (base.empty()) {
+        log_error("No hay preguntas para la prueba");
+        return 1;
+    }
+    Corpus corpus = build_corpus(base, options);
+    
+    // Las mismas preguntas que enviaría la prueba (p. ej. para entrenar PGO)
+    if (options.print_questions > 0) {
+        log_flush();
+        for (size_t i = 0; i < options.print_questions; ++i) {
+            std::string question = corpus.pick(splitmix64(options.seed + i));
+            std::replace(question.begin(), question.end(), '\n', ' ');
+            std::cout << question << '\n';
+        }
+        std::cout.flush();
+        return 0;
+    }
+    
+    curl_global_init(CURL_GLOBAL_ALL);
+    MockOllamaServer mock;
+    const bool use_mock = options.mock || (options.in_process && !options.no_mock);
+    if (use_mock) {
+        if (!mock.start(options.mock_port, options.mock_options)) {
+            return 1;
+        }
+        if (options.in_process) {
+            setenv("OLLAMA_URL", mock.url().c_str(), 1);
+        }
+    }
+
+    // Base de datos propia y vacía: cada ejecución empieza en frío
+    std::unique_ptr<Engine> engine;
+    EngineOptions engine_options = EngineOptions::from_env();
+    engine_options.db_path = "/tmp/ia_migrante_load_test_" + std::to_string(getpid()) + ".db";
+    if (options.in_process) {
+        engine.reset(new Engine(engine_options));
+        if (!engine->start()) {
+            return 1;
+        }
+    }
+    
+    Run run = run_load(options, corpus, engine.get());
+    
+    if (engine) {
+        engine->stop();
+        for (const char* suffix : {"", "-wal", "-shm"}) {
+            std::remove((engine_options.db_path + suffix).c_str());
+        }
+    }
+    mock.stop();
+    report(options, corpus, run, mock.generations());
+    curl_global_cleanup();
+    return 0;
+}
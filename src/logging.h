@@ -0,0 +1,481 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <initializer_list>
+#include <type_traits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+// Log asíncrono compartido por el servidor y el cliente. Cada hilo escribe en
+// su propio búfer circular (un productor, un consumidor) sin bloqueos ni
+// llamadas al sistema; un hilo en segundo plano vacía todos los búferes y
+// escribe cada tanda de una vez en stdout o en un archivo con rotación. Si el
+// búfer de un hilo se llena, sus mensajes DEBUG e INFO se descartan (se
+// cuentan en log_stats()) y solo los ERROR esperan a que haya hueco.
+//
+// Configuración (variables de entorno, se leen una vez):
+//   LOG_LEVEL      debug | info | error                 (info)
+//   LOG_FORMAT     text | json (una línea JSON por mensaje) (text)
+//   LOG_FILE       archivo de destino en lugar de stdout
+//   LOG_MAX_BYTES  tamaño a partir del cual se rota, 0 no rota (10 MB)
+//   LOG_MAX_FILES  archivos rotados que se conservan (.1, .2, ...) (5)
+// LOG_MIN_LEVEL (0 debug, 1 info, 2 error) elimina en compilación los niveles
+// inferiores; para evitar también construir el mensaje, usar log_enabled().
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+enum class LogLevel { DEBUG = 0, INFO = 1, ERROR = 2 };
+
+// Campo estructurado: {"tier", "cache"}, {"ms", 0.4}, {"hits", 3}. Los
+// números se guardan tal cual y los formatea el hilo que escribe el log.
+struct LogField {
+    enum class Kind { TEXT, INTEGER, UNSIGNED, REAL, BOOLEAN };
+
+    const char* key;
+    Kind kind;
+    std::string text;
+    union {
+        int64_t integer;
+        uint64_t unsigned_integer;
+        double real;
+        bool boolean;
+    };
+
+    LogField(const char* key, std::string value) : key(key), kind(Kind::TEXT), text(std::move(value)), integer(0) {}
+    LogField(const char* key, const char* value) : key(key), kind(Kind::TEXT), text(value), integer(0) {}
+
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    LogField(const char* key, T value) : key(key), integer(0) {
+        if constexpr (std::is_same<T, bool>::value) {
+            kind = Kind::BOOLEAN;
+            boolean = value;
+        } else if constexpr (std::is_floating_point<T>::value) {
+            kind = Kind::REAL;
+            real = static_cast<double>(value);
+        } else if constexpr (std::is_signed<T>::value) {
+            kind = Kind::INTEGER;
+            integer = static_cast<int64_t>(value);
+        } else {
+            kind = Kind::UNSIGNED;
+            unsigned_integer = static_cast<uint64_t>(value);
+        }
+    }
+
+    std::string value() const {
+        char buffer[32];
+        switch (kind) {
+            case Kind::TEXT: return text;
+            case Kind::INTEGER: return std::to_string(integer);
+            case Kind::UNSIGNED: return std::to_string(unsigned_integer);
+            case Kind::BOOLEAN: return boolean ? "true" : "false";
+            case Kind::REAL: break;
+        }
+        std::snprintf(buffer, sizeof(buffer), "%.3f", real);
+        return buffer;
+    }
+};
+
+using LogFields = std::vector<LogField>;
+
+namespace logging_detail {
+
+struct Record {
+    LogLevel level = LogLevel::INFO;
+    int64_t time_us = 0;            // Desde la época (reloj del sistema)
+    uint64_t request_id = 0;
+    std::string message;
+    LogFields fields;
+};
+
+// Búfer circular de un hilo: solo él avanza head y solo quien vacía avanza tail
+struct Ring {
+    static constexpr size_t CAPACITY = 1024;
+
+    Record slots[CAPACITY];
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<bool> orphaned{false};      // El hilo terminó; se quita al quedar vacío
+    unsigned thread_number = 0;
+};
+
+inline thread_local uint64_t current_request_id = 0;
+
+class Logger {
+public:
+    static Logger& instance() {
+        // Nunca se destruye: los hilos pueden seguir registrando mientras el proceso termina
+        static Logger* logger = [] {
+            auto* created = new Logger();
+            std::atexit([] { Logger::instance().shutdown(); });
+            return created;
+        }();
+        return *logger;
+    }
+
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= LOG_MIN_LEVEL && level >= min_level_;
+    }
+
+    void write(LogLevel level, std::string message, LogFields fields) {
+        Ring& ring = local_ring();
+        const uint64_t head = ring.head.load(std::memory_order_relaxed);
+        while (head - ring.tail.load(std::memory_order_acquire) >= Ring::CAPACITY) {
+            // Lleno: un mensaje por debajo de ERROR se descarta (y se cuenta)
+            // para no frenar la petición; un ERROR espera a que se vacíe
+            if (!running_.load(std::memory_order_acquire)) {
+                drain();
+                continue;
+            }
+            cv_.notify_one();
+            if (level < LogLevel::ERROR) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            stalls_.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+
+        Record& record = ring.slots[head % Ring::CAPACITY];
+        record.level = level;
+        record.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        record.request_id = current_request_id;
+        record.message = std::move(message);
+        record.fields = std::move(fields);
+        ring.head.store(head + 1, std::memory_order_release);
+
+        if (!running_.load(std::memory_order_acquire)) {
+            drain();
+        } else if (level == LogLevel::ERROR || head - ring.tail.load(std::memory_order_relaxed) >= Ring::CAPACITY / 2) {
+            cv_.notify_one();
+        }
+    }
+
+    // Escribir ya todo lo pendiente (antes de imprimir una respuesta o de salir)
+    void flush() {
+        drain();
+    }
+
+    // Esperas de un ERROR con el búfer lleno y mensajes descartados por lo mismo
+    uint64_t stalls() const { return stalls_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    Logger() {
+        if (const char* env = std::getenv("LOG_LEVEL")) {
+            if (std::strcmp(env, "debug") == 0) min_level_ = LogLevel::DEBUG;
+            else if (std::strcmp(env, "error") == 0) min_level_ = LogLevel::ERROR;
+        }
+        if (const char* env = std::getenv("LOG_FORMAT")) json_ = std::strcmp(env, "json") == 0;
+        if (const char* env = std::getenv("LOG_MAX_BYTES")) max_bytes_ = std::strtoull(env, nullptr, 10);
+        if (const char* env = std::getenv("LOG_MAX_FILES")) max_files_ = std::strtoul(env, nullptr, 10);
+        if (const char* env = std::getenv("LOG_FILE")) {
+            path_ = env;
+            open_file();
+        }
+
+        running_ = true;
+        thread_ = std::thread(&Logger::run, this);
+    }
+
+    Ring& local_ring() {
+        // El hilo guarda una referencia; la lista también, hasta vaciar el búfer
+        struct Owner {
+            std::shared_ptr<Ring> ring;
+            ~Owner() {
+                if (ring) ring->orphaned = true;
+            }
+        };
+        thread_local Owner owner;
+        if (!owner.ring) {
+            owner.ring = std::make_shared<Ring>();
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            owner.ring->thread_number = ++thread_count_;
+            rings_.push_back(owner.ring);
+        }
+        return *owner.ring;
+    }
+
+    void run() {
+        while (running_.load(std::memory_order_acquire)) {
+            {
+                std::unique_lock<std::mutex> lock(wait_mutex_);
+                cv_.wait_for(lock, std::chrono::milliseconds(50));
+            }
+            drain();
+        }
+    }
+
+    void shutdown() {
+        if (running_.exchange(false)) {
+            cv_.notify_one();
+            thread_.join();
+        }
+        drain();
+    }
+
+    // Vacía todos los búferes; se serializa con drain_mutex_ (un solo consumidor)
+    void drain() {
+        std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings = rings_;
+        }
+
+        buffer_.clear();
+        for (const auto& ring : rings) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            for (; tail < head; ++tail) {
+                Record& record = ring->slots[tail % Ring::CAPACITY];
+                format(record, ring->thread_number);
+                // Liberar aquí, fuera del hilo que registra: el siguiente
+                // move sobre el hueco vacío no tiene nada que liberar
+                std::string().swap(record.message);
+                LogFields().swap(record.fields);
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+        if (!buffer_.empty()) {
+            emit();
+        }
+
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (size_t i = 0; i < rings_.size();) {
+            Ring& ring = *rings_[i];
+            if (ring.orphaned && ring.tail.load() == ring.head.load()) {
+                rings_.erase(rings_.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    void format(const Record& record, unsigned thread_number) {
+        if (!json_) {
+            static const char* const PREFIXES[] = {"🔍 [DEBUG] ", "✅ [INFO] ", "❌ [ERROR] "};
+            buffer_ += PREFIXES[static_cast<int>(record.level)];
+            buffer_ += record.message;
+            if (record.request_id != 0) {
+                buffer_ += " request_id=" + std::to_string(record.request_id);
+            }
+            for (const auto& field : record.fields) {
+                buffer_ += ' ';
+                buffer_ += field.key;
+                buffer_ += '=';
+                // Entre comillas solo si hace falta, para que cada mensaje ocupe una línea
+                if (field.kind == LogField::Kind::TEXT &&
+                    (field.text.empty() || field.text.find_first_of(" \"\\\n\r\t=") != std::string::npos)) {
+                    append_json_string(field.text);
+                } else {
+                    buffer_ += field.value();
+                }
+            }
+            buffer_ += '\n';
+            return;
+        }
+
+        static const char* const LEVELS[] = {"debug", "info", "error"};
+        char time_text[40];
+        const std::time_t seconds = static_cast<std::time_t>(record.time_us / 1000000);
+        std::tm utc;
+        gmtime_r(&seconds, &utc);
+        const size_t length = std::strftime(time_text, sizeof(time_text), "%Y-%m-%dT%H:%M:%S", &utc);
+        std::snprintf(time_text + length, sizeof(time_text) - length, ".%06dZ", static_cast<int>(record.time_us % 1000000));
+
+        buffer_ += "{\"ts\":\"";
+        buffer_ += time_text;
+        buffer_ += "\",\"level\":\"";
+        buffer_ += LEVELS[static_cast<int>(record.level)];
+        buffer_ += "\",\"thread\":" + std::to_string(thread_number);
+        if (record.request_id != 0) {
+            buffer_ += ",\"request_id\":" + std::to_string(record.request_id);
+        }
+        buffer_ += ",\"msg\":";
+        append_json_string(record.message);
+        for (const auto& field : record.fields) {
+            buffer_ += ',';
+            append_json_string(field.key);
+            buffer_ += ':';
+            if (field.kind == LogField::Kind::TEXT) {
+                append_json_string(field.text);
+            } else {
+                buffer_ += field.value();
+            }
+        }
+        buffer_ += "}\n";
+    }
+
+    void append_json_string(const std::string& text) {
+        buffer_ += '"';
+        for (unsigned char c : text) {
+            switch (c) {
+                case '"': buffer_ += "\\\""; break;
+                case '\\': buffer_ += "\\\\"; break;
+                case '\n': buffer_ += "\\n"; break;
+                case '\r': buffer_ += "\\r"; break;
+                case '\t': buffer_ += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        buffer_ += escaped;
+                    } else {
+                        buffer_ += static_cast<char>(c);
+                    }
+            }
+        }
+        buffer_ += '"';
+    }
+
+    // Una sola escritura por tanda
+    void emit() {
+        FILE* out = file_ ? file_ : stdout;
+        std::fwrite(buffer_.data(), 1, buffer_.size(), out);
+        std::fflush(out);
+        if (file_) {
+            file_bytes_ += buffer_.size();
+            if (max_bytes_ > 0 && file_bytes_ >= max_bytes_) {
+                rotate();
+            }
+        }
+    }
+
+    void open_file() {
+        file_ = std::fopen(path_.c_str(), "a");
+        if (!file_) {
+            std::fprintf(stderr, "❌ [ERROR] No se pudo abrir el archivo de log %s; se usa stdout\n", path_.c_str());
+            return;
+        }
+        std::fseek(file_, 0, SEEK_END);
+        file_bytes_ = static_cast<uint64_t>(std::ftell(file_));
+    }
+
+    // path -> path.1 -> path.2 ... y se descarta el más antiguo
+    void rotate() {
+        std::fclose(file_);
+        file_ = nullptr;
+        if (max_files_ == 0) {
+            std::remove(path_.c_str());
+        }
+        for (unsigned i = max_files_; i > 0; --i) {
+            const std::string from = i == 1 ? path_ : path_ + "." + std::to_string(i - 1);
+            std::rename(from.c_str(), (path_ + "." + std::to_string(i)).c_str());
+        }
+        open_file();
+    }
+
+    LogLevel min_level_ = LogLevel::INFO;
+    bool json_ = false;
+    std::string path_;
+    FILE* file_ = nullptr;
+    uint64_t file_bytes_ = 0;
+    uint64_t max_bytes_ = 10 * 1024 * 1024;
+    unsigned max_files_ = 5;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    unsigned thread_count_ = 0;
+
+    std::mutex drain_mutex_;
+    std::string buffer_;            // Protegido por drain_mutex_
+
+    std::thread thread_;
+    std::mutex wait_mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace logging_detail
+
+// Para no construir mensajes caros que se van a descartar
+inline bool log_enabled(LogLevel level) {
+    return logging_detail::Logger::instance().enabled(level);
+}
+
+inline void log_message(LogLevel level, std::string message, LogFields fields = {}) {
+    auto& logger = logging_detail::Logger::instance();
+    if (logger.enabled(level)) {
+        logger.write(level, std::move(message), std::move(fields));
+    }
+}
+
+// Funciones de log compartidas por el servidor y el cliente. Las variantes con
+// const char* no construyen el std::string si el nivel está desactivado.
+inline void log_info(std::string message, LogFields fields = {}) {
+    log_message(LogLevel::INFO, std::move(message), std::move(fields));
+}
+
+inline void log_info(const char* message, LogFields fields = {}) {
+    if (log_enabled(LogLevel::INFO)) log_message(LogLevel::INFO, message, std::move(fields));
+}
+
+inline void log_error(std::string message, LogFields fields = {}) {
+    log_message(LogLevel::ERROR, std::move(message), std::move(fields));
+}
+
+inline void log_error(const char* message, LogFields fields = {}) {
+    if (log_enabled(LogLevel::ERROR)) log_message(LogLevel::ERROR, message, std::move(fields));
+}
+
+inline void log_debug(std::string message, LogFields fields = {}) {
+    log_message(LogLevel::DEBUG, std::move(message), std::move(fields));
+}
+
+inline void log_debug(const char* message, LogFields fields = {}) {
+    if (log_enabled(LogLevel::DEBUG)) log_message(LogLevel::DEBUG, message, std::move(fields));
+}
+
+// Búferes llenos: mensajes descartados (DEBUG e INFO) y esperas (ERROR)
+struct LogStats {
+    uint64_t dropped = 0;
+    uint64_t stalls = 0;
+};
+
+inline LogStats log_stats() {
+    const auto& logger = logging_detail::Logger::instance();
+    LogStats stats;
+    stats.dropped = logger.dropped();
+    stats.stalls = logger.stalls();
+    return stats;
+}
+
+// Escribe ya lo pendiente; útil antes de imprimir en stdout fuera del log
+inline void log_flush() {
+    logging_detail::Logger::instance().flush();
+}
+
+// Identificador de la petición que atiende este hilo; aparece en cada mensaje
+inline uint64_t log_next_request_id() {
+    static std::atomic<uint64_t> next{0};
+    return ++next;
+}
+
+class LogRequestScope {
+public:
+    explicit LogRequestScope(uint64_t request_id) : previous_(logging_detail::current_request_id) {
+        logging_detail::current_request_id = request_id;
+    }
+    ~LogRequestScope() { logging_detail::current_request_id = previous_; }
+
+    LogRequestScope(const LogRequestScope&) = delete;
+    LogRequestScope& operator=(const LogRequestScope&) = delete;
+
+private:
+    uint64_t previous_;
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+// Histograma de latencias sin bloqueos, con cubetas logarítmicas al estilo
+// HDR: dos cubetas por cada potencia de dos (error relativo <= 50 %) desde
+// 2 µs hasta ~134 s, más una de desbordamiento. Registrar un valor cuesta un
+// cálculo de bits y tres sumas atómicas relajadas, así que puede usarse en
+// cada petición. La cubeta i contiene los valores en (límite(i-1), límite(i)].
+class LatencyHistogram {
+public:
+    static constexpr size_t OCTAVES = 27;
+    static constexpr size_t BUCKETS = 2 * OCTAVES;     // La última es +Inf
+
+    void record(std::chrono::steady_clock::duration elapsed) {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        record_us(us > 0 ? static_cast<uint64_t>(us) : 0);
+    }
+
+    void record_ms(double ms) { record_us(ms > 0 ? static_cast<uint64_t>(ms * 1000.0) : 0); }
+
+    void record_us(uint64_t us) {
+        buckets_[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_us_.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    // Límite superior (incluido) de la cubeta en µs; la última no tiene
+    static uint64_t upper_bound_us(size_t index) {
+        if (index == 0) {
+            return 2;
+        }
+        const size_t octave = (index + 1) / 2;
+        const uint64_t base = uint64_t(1) << octave;
+        return index % 2 == 1 ? base + base / 2 : base * 2;
+    }
+
+    uint64_t bucket(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum_us() const { return sum_us_.load(std::memory_order_relaxed); }
+
+    double average_ms() const {
+        const uint64_t n = count();
+        return n > 0 ? sum_us() / 1000.0 / n : 0.0;
+    }
+
+    // Cota superior del percentil q (0-1) en ms: el límite de su cubeta
+    double percentile_ms(double q) const {
+        const uint64_t n = count();
+        if (n == 0) {
+            return 0.0;
+        }
+        const uint64_t rank = static_cast<uint64_t>(q * (n - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i + 1 < BUCKETS; ++i) {
+            seen += bucket(i);
+            if (seen >= rank) {
+                return upper_bound_us(i) / 1000.0;
+            }
+        }
+        return upper_bound_us(BUCKETS - 2) / 1000.0;
+    }
+
+private:
+    // Se calcula sobre us - 1 para que los límites queden incluidos en su cubeta
+    static size_t bucket_index(uint64_t us) {
+        const uint64_t x = us > 0 ? us - 1 : 0;
+        if (x < 2) {
+            return 0;
+        }
+        const size_t octave = 63 - static_cast<size_t>(__builtin_clzll(x));
+        const size_t half = (x >> (octave - 1)) & 1;
+        const size_t index = 2 * octave - 1 + half;
+        return index < BUCKETS ? index : BUCKETS - 1;
+    }
+
+    std::atomic<uint64_t> buckets_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_us_{0};
+};
+
+// Texto en el formato de exposición de Prometheus (text/plain; version=0.0.4).
+// Las líneas HELP y TYPE se escriben la primera vez que aparece cada métrica,
+// así que las series de una misma métrica deben ir seguidas.
+class PrometheusWriter {
+public:
+    void counter(const std::string& name, const std::string& help, double value, const std::string& labels = "") {
+        family(name, help, "counter");
+        sample(name, labels, value);
+    }
+
+    void gauge(const std::string& name, const std::string& help, double value, const std::string& labels = "") {
+        family(name, help, "gauge");
+        sample(name, labels, value);
+    }
+
+    // Histograma en segundos (cubetas acumuladas, _sum y _count)
+    void histogram(const std::string& name, const std::string& help, const LatencyHistogram& histogram,
+                   const std::string& labels = "") {
+        family(name, help, "histogram");
+        const std::string prefix = labels.empty() ? "" : labels + ",";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i + 1 < LatencyHistogram::BUCKETS; ++i) {
+            cumulative += histogram.bucket(i);
+            sample(name + "_bucket", prefix + "le=\"" + format(LatencyHistogram::upper_bound_us(i) / 1e6) + "\"",
+                   static_cast<double>(cumulative));
+        }
+        cumulative += histogram.bucket(LatencyHistogram::BUCKETS - 1);
+        sample(name + "_bucket", prefix + "le=\"+Inf\"", static_cast<double>(cumulative));
+        sample(name + "_sum", labels, histogram.sum_us() / 1e6);
+        sample(name + "_count", labels, static_cast<double>(cumulative));
+    }
+
+    const std::string& text() const { return out_; }
+
+    // Escapa un valor de etiqueta (barra invertida, comillas y saltos de línea)
+    static std::string label(const std::string& key, const std::string& value) {
+        std::string escaped;
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return key + "=\"" + escaped + "\"";
+    }
+
+private:
+    void family(const std::string& name, const std::string& help, const char* type) {
+        if (name == last_family_) {
+            return;
+        }
+        last_family_ = name;
+        out_ += "# HELP " + name + " " + help + "\n";
+        out_ += "# TYPE " + name + " " + type + "\n";
+    }
+
+    void sample(const std::string& name, const std::string& labels, double value) {
+        out_ += name;
+        if (!labels.empty()) {
+            out_ += "{" + labels + "}";
+        }
+        out_ += " " + format(value) + "\n";
+    }
+
+    static std::string format(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    std::string out_;
+    std::string last_family_;
+};
@@ -0,0 +1,476 @@
+// Microbenchmarks (Google Benchmark) de las funciones que corren en cada
+// petición: normalización, detección de idioma, clasificación de preguntas,
+// búsqueda en la base de conocimiento y respuesta por palabras clave. Las
+// entradas son las preguntas reales de dataset/*.json. Además del tiempo,
+// cada benchmark cuenta las asignaciones de memoria por operación.
+//
+// --write-baseline FICHERO guarda los resultados; --baseline FICHERO los
+// compara con uno guardado y termina con error si algún benchmark asigna más
+// memoria por operación (no depende de la máquina) o, solo con
+// --max-regression P, si es más de P por ciento más lento (los tiempos de la
+// línea base son los de una máquina concreta). El resto de opciones son las
+// de Google Benchmark (--benchmark_filter, --benchmark_repetitions...); con
+// repeticiones se compara la mediana.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <new>
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include "engine.h"
+#include "keyword_responses.h"
+#include "text_utils.h"
+#include "logging.h"
+
+using json = nlohmann::json;
+
+// ---------------------------------------------------------------------------
+// Contador de asignaciones: todas las del programa pasan por aquí. Es por
+// hilo, para no contar lo que asigne otro hilo (el del log) durante la medida.
+// Se reemplaza la familia completa (escalar, [], nothrow y alineada): la
+// biblioteca estándar usa también las variantes nothrow (_Temporary_buffer de
+// std::stable_sort) y, si alguna quedara con la implementación original, su
+// memoria acabaría en el free() de estos delete (ASan lo señala como
+// alloc-dealloc-mismatch).
+
+static thread_local uint64_t t_allocations = 0;
+static thread_local uint64_t t_allocated_bytes = 0;
+
+constexpr size_t DEFAULT_ALIGNMENT = alignof(std::max_align_t);
+
+// nullptr si no hay memoria
+static void* counted_alloc(size_t size, size_t alignment) {
+    t_allocations++;
+    t_allocated_bytes += size;
+    if (size == 0) {
+        size = 1;
+    }
+    if (alignment <= DEFAULT_ALIGNMENT) {
+        return std::malloc(size);
+    }
+    void* p = nullptr;
+    return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+}
+
+static void* counted_alloc_or_throw(size_t size, size_t alignment) {
+    if (void* p = counted_alloc(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Sin inline: si GCC ve el malloc() y el free() dentro del llamador avisa (en
+// falso) de que el new y el delete no casan
+__attribute__((noinline)) void* operator new(size_t size) { return counted_alloc_or_throw(size, DEFAULT_ALIGNMENT); }
+__attribute__((noinline)) void* operator new[](size_t size) { return counted_alloc_or_throw(size, DEFAULT_ALIGNMENT); }
+__attribute__((noinline)) void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, DEFAULT_ALIGNMENT);
+}
+__attribute__((noinline)) void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, DEFAULT_ALIGNMENT);
+}
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t alignment) {
+    return counted_alloc_or_throw(size, static_cast<size_t>(alignment));
+}
+__attribute__((noinline)) void* operator new[](size_t size, std::align_val_t alignment) {
+    return counted_alloc_or_throw(size, static_cast<size_t>(alignment));
+}
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, static_cast<size_t>(alignment));
+}
+__attribute__((noinline)) void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return counted_alloc(size, static_cast<size_t>(alignment));
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+// Publica allocs/op y bytes/op de lo asignado mientras dura el bucle
+class AllocationCounter {
+public:
+    explicit AllocationCounter(benchmark::State& state)
+        : state_(state), allocations_(t_allocations), bytes_(t_allocated_bytes) {}
+    
+    ~AllocationCounter() {
+        const double allocations = static_cast<double>(t_allocations - allocations_);
+        const double bytes = static_cast<double>(t_allocated_bytes - bytes_);
+        state_.counters["allocs/op"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+        state_.counters["bytes/op"] = benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& state_;
+    uint64_t allocations_;
+    uint64_t bytes_;
+};
+
+// ---------------------------------------------------------------------------
+// Entradas
+
+struct BenchData {
+    std::vector<std::string> questions;             // Tal como las escribe el usuario
+    std::vector<std::string> paraphrased;           // Con saludo y sin signos: no coinciden exactamente
+    std::vector<std::string> normalized;
+    std::deque<TokenizedText> tokenized;            // No se pueden mover: deque no los recoloca
+    std::deque<TokenizedText> tokenized_paraphrased;
+    std::deque<TokenizedText> tokenized_stored;     // Texto exacto de la base de conocimiento
+    std::deque<TokenizedText> tokenized_unrelated; // Sin respuesta en la base de conocimiento
+    KnowledgeBase kb;
+};
+
+static BenchData g_data;
+
+// Solo para search_knowledge_base con las opciones del servidor; no se arranca
+static const Engine g_engine;
+
+// Carga el dataset en la base de conocimiento y prepara las entradas
+static bool load_bench_data(const std::string& dataset_dir) {
+    for (const char* name : {"nolivos_immigration_ai_extended.json", "nolivos_immigration_qa.json"}) {
+        std::ifstream file(dataset_dir + "/" + name);
+        if (!file.is_open()) {
+            continue;
+        }
+        json root = json::parse(file, nullptr, false);
+        if (!root.is_object()) {
+            log_error("JSON no válido: " + dataset_dir + "/" + name);
+            return false;
+        }
+        if (g_data.kb.store.size() == 0) {
+            g_data.kb.store.load_json(root, normalize_into);
+        }
+        for (const auto& category : root.items()) {
+            if (!category.value().is_array()) continue;
+            for (const auto& entry : category.value()) {
+                if (entry.is_object() && entry.contains("question") && entry["question"].is_string()) {
+                    std::string question = entry["question"].get<std::string>();
+                    const std::string prefix = "**Pregunta**: ";
+                    if (question.compare(0, prefix.size(), prefix) == 0) {
+                        question.erase(0, prefix.size());
+                    }
+                    g_data.questions.push_back(question);
+                }
+            }
+        }
+    }
+    if (g_data.questions.empty()) {
+        log_error("No se encontraron preguntas en " + dataset_dir);
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < g_data.kb.store.size(); ++i) {
+        g_data.kb.index.add_document(i, g_data.kb.store.normalized_question(i));
+    }
+    g_data.kb.index.finish();
+    
+    for (const auto& question : g_data.questions) {
+        std::string paraphrased = "Hola, " + question;
+        for (const char* mark : {"¿", "?"}) {
+            for (size_t pos; (pos = paraphrased.find(mark)) != std::string::npos;) {
+                paraphrased.erase(pos, std::strlen(mark));
+            }
+        }
+        g_data.paraphrased.push_back(paraphrased);
+        g_data.normalized.push_back(normalize_text(question));
+        g_data.tokenized.emplace_back(question);
+        g_data.tokenized_paraphrased.emplace_back(paraphrased);
+    }
+    for (uint32_t i = 0; i < g_data.kb.store.size(); ++i) {
+        g_data.tokenized_stored.emplace_back(std::string(g_data.kb.store.question(i)));
+    }
+    for (const char* question : {"hola", "¿qué hora es?", "gracias por la ayuda", "¿dónde queda la oficina más cercana?",
+                                 "Necesito ayuda con mi caso", "What is the weather like today?"}) {
+        g_data.tokenized_unrelated.emplace_back(question);
+    }
+    
+    log_info("Microbenchmarks: " + std::to_string(g_data.questions.size()) + " preguntas, " +
+             std::to_string(g_data.kb.store.size()) + " entradas en la base de conocimiento");
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks: cada iteración procesa la siguiente pregunta del dataset
+
+static void BM_NormalizeText(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0, bytes = 0;
+    for (auto _ : state) {
+        const std::string& question = g_data.questions[i++ % g_data.questions.size()];
+        benchmark::DoNotOptimize(normalize_text(question));
+        bytes += question.size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_NormalizeText);
+
+static void BM_TokenizeQuestion(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        TokenizedText query(g_data.questions[i++ % g_data.questions.size()]);
+        benchmark::DoNotOptimize(query.normalized().data());
+    }
+}
+BENCHMARK(BM_TokenizeQuestion);
+
+static void BM_DetectLanguage(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(detect_language(g_data.questions[i++ % g_data.questions.size()]));
+    }
+}
+BENCHMARK(BM_DetectLanguage);
+
+// Como en el servidor: sobre la pregunta ya tokenizada
+static void BM_GuessLanguage(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(guess_language(g_data.tokenized[i++ % g_data.tokenized.size()]));
+    }
+}
+BENCHMARK(BM_GuessLanguage);
+
+static void BM_IsComplexQuestion(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(is_complex_question(g_data.tokenized[i++ % g_data.tokenized.size()]));
+    }
+}
+BENCHMARK(BM_IsComplexQuestion);
+
+// El texto guardado de cada entrada: acierta en la tabla de coincidencias exactas
+static void BM_SearchKnowledgeBase_Exact(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        const TokenizedText& query = g_data.tokenized_stored[i++ % g_data.tokenized_stored.size()];
+        benchmark::DoNotOptimize(g_engine.search_knowledge_base(g_data.kb, query, "es"));
+    }
+}
+BENCHMARK(BM_SearchKnowledgeBase_Exact);
+
+// La pregunta como la escribe el usuario (sin el prefijo del dataset): búsqueda BM25
+static void BM_SearchKnowledgeBase_Ranked(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        const TokenizedText& query = g_data.tokenized[i++ % g_data.tokenized.size()];
+        benchmark::DoNotOptimize(g_engine.search_knowledge_base(g_data.kb, query, "es"));
+    }
+}
+BENCHMARK(BM_SearchKnowledgeBase_Ranked);
+
+// Parafraseada (saludo, sin signos): más palabras que puntuar
+static void BM_SearchKnowledgeBase_Paraphrased(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        const TokenizedText& query = g_data.tokenized_paraphrased[i++ % g_data.tokenized_paraphrased.size()];
+        benchmark::DoNotOptimize(g_engine.search_knowledge_base(g_data.kb, query, "es"));
+    }
+}
+BENCHMARK(BM_SearchKnowledgeBase_Paraphrased);
+
+static void BM_SearchKnowledgeBase_Miss(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        const TokenizedText& query = g_data.tokenized_unrelated[i++ % g_data.tokenized_unrelated.size()];
+        benchmark::DoNotOptimize(g_engine.search_knowledge_base(g_data.kb, query, "es"));
+    }
+}
+BENCHMARK(BM_SearchKnowledgeBase_Miss);
+
+static void BM_GenerateResponse(benchmark::State& state) {
+    AllocationCounter allocations(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(generate_response(g_data.normalized[i++ % g_data.normalized.size()]));
+    }
+}
+BENCHMARK(BM_GenerateResponse);
+
+// ---------------------------------------------------------------------------
+// Línea base y control de regresiones
+
+struct BenchResult {
+    double cpu_ns = 0.0;
+    double allocs_per_op = 0.0;
+    double bytes_per_op = 0.0;
+};
+
+// Muestra los resultados en consola y guarda los de cada benchmark
+// (la mediana si hay repeticiones)
+class RecordingReporter : public benchmark::ConsoleReporter {
+public:
+    void ReportRuns(const std::vector<Run>& runs) override {
+        ConsoleReporter::ReportRuns(runs);
+        for (const auto& run : runs) {
+            if (run.error_occurred) continue;
+            const bool median = run.run_type == Run::RT_Aggregate && run.aggregate_name == "median";
+            if (run.run_type == Run::RT_Aggregate && !median) continue;
+            const std::string name = run.run_name.str();
+            if (!median && medians_.count(name)) continue;
+            
+            BenchResult result;
+            result.cpu_ns = run.GetAdjustedCPUTime() * nanoseconds_per(run.time_unit);
+            auto allocs = run.counters.find("allocs/op");
+            if (allocs != run.counters.end()) result.allocs_per_op = allocs->second.value;
+            auto bytes = run.counters.find("bytes/op");
+            if (bytes != run.counters.end()) result.bytes_per_op = bytes->second.value;
+            results[name] = result;
+            if (median) medians_.insert(name);
+        }
+    }
+    
+    std::map<std::string, BenchResult> results;
+
+private:
+    static double nanoseconds_per(benchmark::TimeUnit unit) {
+        switch (unit) {
+            case benchmark::kSecond: return 1e9;
+            case benchmark::kMillisecond: return 1e6;
+            case benchmark::kMicrosecond: return 1e3;
+            default: return 1.0;
+        }
+    }
+    
+    std::set<std::string> medians_;
+};
+
+static bool write_baseline(const std::string& path, const std::map<std::string, BenchResult>& results) {
+    json benchmarks = json::object();
+    for (const auto& entry : results) {
+        auto rounded = [](double value) { return std::round(value * 100.0) / 100.0; };
+        benchmarks[entry.first] = {{"cpu_ns", rounded(entry.second.cpu_ns)},
+                                   {"allocs_per_op", rounded(entry.second.allocs_per_op)},
+                                   {"bytes_per_op", rounded(entry.second.bytes_per_op)}};
+    }
+    std::ofstream file(path);
+    file << json{{"benchmarks", benchmarks}}.dump(2) << std::endl;
+    if (!file) {
+        log_error("No se pudo escribir la línea base en " + path);
+        return false;
+    }
+    log_info("Línea base guardada en " + path);
+    return true;
+}
+
+// true si ningún benchmark empeoró más de lo permitido frente a la línea base.
+// El tiempo solo se compara si max_regression_pct >= 0. Las asignaciones por pregunta son deterministas: la media solo varía un poco
+// según en qué pregunta del ciclo acabe la medida, así que se admite un 1 % (o
+// media asignación) y cualquier asignación de más por operación es regresión.
+static bool check_baseline(const std::string& path, const std::map<std::string, BenchResult>& results,
+                           double max_regression_pct) {
+    std::ifstream file(path);
+    json baseline = file.is_open() ? json::parse(file, nullptr, false) : json();
+    if (!baseline.is_object() || !baseline.contains("benchmarks") || !baseline["benchmarks"].is_object()) {
+        log_error("No se pudo leer la línea base " + path);
+        return false;
+    }
+    
+    bool ok = true;
+    const bool check_time = max_regression_pct >= 0.0;
+    log_flush();
+    if (check_time) {
+        std::printf("\nComparación con %s (máximo +%.1f %%)\n", path.c_str(), max_regression_pct);
+    } else {
+        std::printf("\nComparación con %s (solo asignaciones; el tiempo es orientativo)\n", path.c_str());
+    }
+    std::printf("%-34s %12s %12s %9s %14s  %s\n", "benchmark", "base ns", "actual ns", "cambio", "allocs/op", "");
+    for (const auto& entry : results) {
+        const BenchResult& current = entry.second;
+        if (!baseline["benchmarks"].contains(entry.first)) {
+            std::printf("%-34s %12s %12.1f %9s %14.1f  nuevo\n", entry.first.c_str(), "-", current.cpu_ns, "-",
+                        current.allocs_per_op);
+            continue;
+        }
+        const json& base = baseline["benchmarks"][entry.first];
+        const double base_ns = base.value("cpu_ns", 0.0);
+        const double base_allocs = base.value("allocs_per_op", 0.0);
+        const double change_pct = base_ns > 0 ? (current.cpu_ns / base_ns - 1.0) * 100.0 : 0.0;
+        const bool slower = check_time && change_pct > max_regression_pct;
+        const bool more_allocations = current.allocs_per_op > base_allocs + std::max(0.5, base_allocs * 0.01);
+        char allocs[32];
+        std::snprintf(allocs, sizeof(allocs), "%.1f -> %.1f", base_allocs, current.allocs_per_op);
+        std::printf("%-34s %12.1f %12.1f %+8.1f%% %14s  %s\n", entry.first.c_str(), base_ns, current.cpu_ns,
+                    change_pct, allocs, slower ? "MÁS LENTO" : more_allocations ? "MÁS ASIGNACIONES" : "ok");
+        ok = ok && !slower && !more_allocations;
+    }
+    std::printf("%s\n", ok ? "Sin regresiones" : "Hay regresiones respecto a la línea base");
+    std::fflush(stdout);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    std::string dataset_dir;
+    std::string baseline_path;
+    std::string write_path;
+    double max_regression_pct = -1.0;    // Sin --max-regression no se compara el tiempo
+    
+    // Opciones propias; el resto se pasa a Google Benchmark
+    std::vector<char*> args = {argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dataset" && i + 1 < argc) {
+            dataset_dir = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--write-baseline" && i + 1 < argc) {
+            write_path = argv[++i];
+        } else if (arg == "--max-regression" && i + 1 < argc) {
+            max_regression_pct = std::strtod(argv[++i], nullptr);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    int bench_argc = static_cast<int>(args.size());
+    benchmark::Initialize(&bench_argc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(bench_argc, args.data())) {
+        return 1;
+    }
+    
+    if (dataset_dir.empty()) {
+        dataset_dir = std::ifstream("../dataset/nolivos_immigration_qa.json").is_open() ? "../dataset" : "dataset";
+    }
+    if (!load_bench_data(dataset_dir)) {
+        return 1;
+    }
+    
+    log_flush();
+    RecordingReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+    
+    if (!write_path.empty() && !write_baseline(write_path, reporter.results)) {
+        return 1;
+    }
+    if (!baseline_path.empty() && !check_baseline(baseline_path, reporter.results, max_regression_pct)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "logging.h"
+
+struct MockOllamaOptions {
+    std::chrono::milliseconds first_token_delay{50};   // Antes del primer token (carga del prompt)
+    std::chrono::milliseconds token_interval{10};      // Entre tokens
+    size_t tokens = 40;                                // Tokens por respuesta
+};
+
+// Servidor HTTP mínimo que imita POST /api/generate de Ollama en modo
+// streaming (NDJSON por chunks) con tiempos configurables, para que las
+// pruebas de carga no dependan de un modelo real. Cada conexión se atiende en
+// su propio hilo y admite keep-alive, igual que el cliente libcurl la reutiliza.
+class MockOllamaServer {
+public:
+    ~MockOllamaServer() { stop(); }
+
+    // port 0 elige un puerto libre; port() devuelve el asignado
+    bool start(uint16_t port, const MockOllamaOptions& options = MockOllamaOptions()) {
+        options_ = options;
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            log_error("Ollama simulado: no se pudo crear el socket");
+            return false;
+        }
+        int reuse = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        socklen_t length = sizeof(addr);
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listen_fd_, 128) != 0 ||
+            ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+            log_error("Ollama simulado: no se pudo escuchar en el puerto " + std::to_string(port) + ": " +
+                      std::strerror(errno));
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        running_ = true;
+        acceptor_ = std::thread(&MockOllamaServer::accept_loop, this);
+        log_info("Ollama simulado escuchando en " + url());
+        return true;
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        ::close(listen_fd_);
+        acceptor_.join();
+
+        std::vector<std::thread> connections;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int fd : client_fds_) {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+            connections.swap(connections_);
+        }
+        for (auto& connection : connections) {
+            connection.join();
+        }
+    }
+
+    uint16_t port() const { return port_; }
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port_) + "/api/generate"; }
+    uint64_t generations() const { return generations_.load(); }
+
+private:
+    void accept_loop() {
+        while (running_) {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (!running_) {
+                    break;
+                }
+                continue;
+            }
+            int nodelay = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            std::lock_guard<std::mutex> lock(mutex_);
+            client_fds_.push_back(fd);
+            connections_.emplace_back(&MockOllamaServer::serve, this, fd);
+        }
+    }
+
+    // Atiende peticiones en la conexión hasta que el cliente la cierre
+    void serve(int fd) {
+        std::string buffer;
+        while (running_) {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                if (!receive(fd, buffer)) {
+                    return close_client(fd);
+                }
+            }
+            size_t content_length = 0;
+            const char* length_header = strcasestr(buffer.c_str(), "\r\nContent-Length:");
+            if (length_header && length_header < buffer.c_str() + header_end) {
+                content_length = std::strtoul(length_header + 17, nullptr, 10);
+            }
+            const size_t request_end = header_end + 4 + content_length;
+            while (buffer.size() < request_end) {
+                if (!receive(fd, buffer)) {
+                    return close_client(fd);
+                }
+            }
+            buffer.erase(0, request_end);
+
+            if (!respond(fd)) {
+                return close_client(fd);
+            }
+        }
+        close_client(fd);
+    }
+
+    bool receive(int fd, std::string& buffer) {
+        char chunk[4096];
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    // Respuesta en streaming: un chunk por token y uno final con done=true
+    bool respond(int fd) {
+        generations_++;
+        static const char* const WORDS[] = {
+            "Según", "la", "normativa", "de", "inmigración", "vigente,", "el", "solicitante", "debe",
+            "presentar", "el", "formulario", "correspondiente", "ante", "USCIS", "con", "la",
+            "documentación", "que", "acredite", "su", "situación", "y", "consultar", "a", "un", "abogado."
+        };
+        const size_t word_count = sizeof(WORDS) / sizeof(WORDS[0]);
+
+        std::string head = "HTTP/1.1 200 OK\r\nContent-Type: application/x-ndjson\r\n"
+                           "Transfer-Encoding: chunked\r\n\r\n";
+        if (!send_all(fd, head)) {
+            return false;
+        }
+        std::this_thread::sleep_for(options_.first_token_delay);
+        for (size_t i = 0; i < options_.tokens; ++i) {
+            if (i > 0) {
+                std::this_thread::sleep_for(options_.token_interval);
+            }
+            std::string line = std::string(R"({"model":"mock","response":")") + WORDS[i % word_count] +
+                               R"( ","done":false})" "\n";
+            if (!send_all(fd, chunk(line))) {
+                return false;
+            }
+        }
+        return send_all(fd, chunk(R"({"model":"mock","response":"","done":true})" "\n") + "0\r\n\r\n");
+    }
+
+    static std::string chunk(const std::string& data) {
+        char size[16];
+        std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+        return size + data + "\r\n";
+    }
+
+    static bool send_all(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void close_client(int fd) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = client_fds_.begin(); it != client_fds_.end(); ++it) {
+            if (*it == fd) {
+                client_fds_.erase(it);
+                break;
+            }
+        }
+        ::close(fd);
+    }
+
+    MockOllamaOptions options_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> generations_{0};
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::vector<int> client_fds_;
+    std::vector<std::thread> connections_;
+};
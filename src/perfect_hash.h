@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <initializer_list>
+#include <cstdint>
+
+// Conjunto estático de palabras con hash perfecto ("hash and displace"): las
+// claves se reparten en cubetas y cada cubeta guarda la semilla que coloca
+// todas sus claves en huecos libres de la tabla. Una consulta cuesta dos
+// hashes y una sola comparación, sin colisiones ni sondeos. Se construye una
+// vez (normalmente como static) y después solo se lee.
+class PerfectHashSet {
+public:
+    static constexpr long NOT_FOUND = -1;
+
+    PerfectHashSet() = default;
+
+    PerfectHashSet(std::initializer_list<std::string_view> keys)
+        : PerfectHashSet(std::vector<std::string_view>(keys)) {}
+
+    explicit PerfectHashSet(const std::vector<std::string_view>& keys) {
+        for (auto key : keys) {
+            if (find_linear(key) == NOT_FOUND) {
+                keys_.emplace_back(key);
+            }
+        }
+        build();
+    }
+
+    // Posición de la clave en el orden de construcción, o NOT_FOUND
+    long find(std::string_view key) const {
+        if (keys_.empty()) {
+            return NOT_FOUND;
+        }
+        const uint32_t seed = seeds_[hash(key, 0) % seeds_.size()];
+        const int32_t index = slots_[hash(key, seed) & slot_mask_];
+        if (index < 0 || keys_[index] != key) {
+            return NOT_FOUND;
+        }
+        return index;
+    }
+
+    bool contains(std::string_view key) const { return find(key) != NOT_FOUND; }
+
+    size_t size() const { return keys_.size(); }
+    const std::string& key(size_t index) const { return keys_[index]; }
+
+private:
+    static uint64_t hash(std::string_view key, uint64_t seed) {
+        uint64_t h = 0xCBF29CE484222325ull ^ (seed * 0x9E3779B97F4A7C15ull);
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 0x100000001B3ull;
+        }
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return h ^ (h >> 32);
+    }
+
+    long find_linear(std::string_view key) const {
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (keys_[i] == key) return static_cast<long>(i);
+        }
+        return NOT_FOUND;
+    }
+
+    void build() {
+        if (keys_.empty()) {
+            return;
+        }
+
+        // Tabla al 50 % como máximo y unas cuatro claves por cubeta
+        size_t table_size = 1;
+        while (table_size < 2 * keys_.size()) {
+            table_size <<= 1;
+        }
+        const size_t bucket_count = std::max<size_t>(1, keys_.size() / 4);
+
+        std::vector<std::vector<uint32_t>> buckets(bucket_count);
+        for (uint32_t i = 0; i < keys_.size(); ++i) {
+            buckets[hash(keys_[i], 0) % bucket_count].push_back(i);
+        }
+
+        // Primero las cubetas más llenas, que son las más difíciles de colocar
+        std::vector<size_t> order(bucket_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        while (true) {
+            slot_mask_ = table_size - 1;
+            slots_.assign(table_size, -1);
+            seeds_.assign(bucket_count, 0);
+            if (place_buckets(buckets, order)) {
+                return;
+            }
+            table_size <<= 1;  // Casi nunca: agrandar la tabla y volver a empezar
+        }
+    }
+
+    bool place_buckets(const std::vector<std::vector<uint32_t>>& buckets, const std::vector<size_t>& order) {
+        static constexpr uint32_t MAX_SEED = 1u << 16;
+        std::vector<size_t> taken;
+
+        for (size_t bucket : order) {
+            if (buckets[bucket].empty()) {
+                break;
+            }
+
+            bool placed = false;
+            for (uint32_t seed = 1; seed < MAX_SEED && !placed; ++seed) {
+                taken.clear();
+                placed = true;
+                for (uint32_t key : buckets[bucket]) {
+                    size_t slot = hash(keys_[key], seed) & slot_mask_;
+                    if (slots_[slot] >= 0 || std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+                if (placed) {
+                    for (size_t i = 0; i < taken.size(); ++i) {
+                        slots_[taken[i]] = static_cast<int32_t>(buckets[bucket][i]);
+                    }
+                    seeds_[bucket] = seed;
+                }
+            }
+            if (!placed) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<std::string> keys_;
+    std::vector<uint32_t> seeds_;   // Semilla de cada cubeta
+    std::vector<int32_t> slots_;    // Índice de la clave en cada hueco, o -1
+    size_t slot_mask_ = 0;
+};
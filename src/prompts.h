@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include "text_utils.h"
+
+// Prompts de Ollama y respuestas de respaldo para casos conocidos
+
+// Pregunta sobre ajuste de TPS a EB1 tras entrar con visa B2
+inline bool is_tps_eb1_question(const std::string& normalized_question) {
+    return scan_question_keywords(normalized_question).tps_eb1;
+}
+
+// Respuesta predefinida para TPS a EB1 cuando el modelo no da una respuesta útil
+inline std::string tps_eb1_fallback(bool long_period) {
+    if (long_period) {
+        return "Para una persona que estuvo sin estatus por más de 180 días antes de obtener TPS, el ajuste a EB1 como beneficiario derivado enfrenta obstáculos significativos:\n\n"
+               "1. La entrada legal con visa B2 es favorable, ya que la persona fue inspeccionada y admitida legalmente.\n\n"
+               "2. Sin embargo, la sección 245(k) solo perdona hasta 180 días sin estatus para casos de empleo como EB1, EB2 y EB3. Con un período más largo sin estatus (años), generalmente no se puede ajustar dentro de EE.UU. a través de categorías basadas en empleo.\n\n"
+               "3. El TPS proporciona estatus legal temporal y autorización de trabajo, pero no elimina las barreras creadas por los largos períodos sin estatus antes de obtenerlo.\n\n"
+               "4. Opciones alternativas podrían incluir:\n"
+               "   - Proceso consular con perdón I-601 por presencia ilegal (implica salir de EE.UU.)\n"
+               "   - Verificar elegibilidad bajo sección 245(i) si existe una petición anterior al 30 de abril de 2001\n"
+               "   - Buscar otras bases para el ajuste como matrimonio con ciudadano, asilo o visa U\n\n"
+               "5. Para beneficiarios derivados de EB1 (cónyuges e hijos solteros menores de 21 años), aplican los mismos requisitos de admisibilidad que para el beneficiario principal.\n\n"
+               "Esta situación compleja requiere consulta con un abogado de inmigración especializado para evaluar todas las opciones disponibles según las circunstancias específicas.";
+    }
+    return "Para ajustar estatus como beneficiario derivado de EB1 después de una entrada legal con visa B2 y posterior TPS, se deben considerar varios factores:\n\n"
+           "1. La entrada legal con visa B2 es favorable, ya que la persona fue inspeccionada y admitida legalmente.\n\n"
+           "2. El período sin estatus entre el vencimiento de la visa B2 y la obtención del TPS puede ser perdonado bajo la sección 245(k) si fue menor a 180 días para casos de empleo como EB1.\n\n"
+           "3. El TPS proporciona un estatus legal temporal y autorización de trabajo, pero no resuelve automáticamente períodos previos sin estatus.\n\n"
+           "4. Para beneficiarios derivados de EB1 (cónyuges e hijos solteros menores de 21 años del beneficiario principal), aplican los mismos requisitos de admisibilidad.\n\n"
+           "En resumen, es posible que esta persona pueda ajustar su estatus si el período sin estatus fue menor a 180 días o si califica para otras excepciones. Se recomienda consultar con un abogado especializado en inmigración para analizar todos los detalles específicos del caso.";
+}
+
+// Respuesta genérica, en el idioma de la pregunta, cuando no hay información
+// sobre ella y no es lo bastante compleja para el modelo
+inline std::string referral_answer(const std::string& language) {
+    if (language == "es") {
+        return "No tengo información específica sobre esa consulta. Para preguntas sobre inmigración, le recomiendo consultar con un abogado especializado o visitar el sitio web oficial de USCIS para obtener información actualizada.";
+    }
+    return "I don't have specific information about that query. For immigration questions, I recommend consulting with a specialized attorney or visiting the official USCIS website for up-to-date information.";
+}
+
+// El modelo se negó a responder o devolvió algo vacío
+inline bool is_refusal(const std::string& response) {
+    return response.empty() ||
+           response.find("no puedo") != std::string::npos || 
+           response.find("lo siento") != std::string::npos ||
+           response.find("manipulación") != std::string::npos ||
+           response.find("no tengo") != std::string::npos;
+}
+
+// Prompt principal para una pregunta de inmigración en el idioma indicado
+inline std::string build_ollama_prompt(const std::string& question, const std::string& language) {
+    const QuestionKeywords keywords = scan_question_keywords(normalize_text(question));
+    bool long_period = keywords.long_period;
+    
+    std::string prompt;
+    
+    if (language == "es") {
+        // Prompt para casos específicos de TPS a EB1
+        if (keywords.tps_eb1) {
+            
+            // Base del prompt
+            prompt = "Como abogado de inmigración de EE.UU., responde SOLO EN ESPAÑOL a esta pregunta específica:\n\n" + 
+                     question + "\n\n";
+            
+            // Instrucciones diferentes según si hay período largo o no
+            if (long_period) {
+                prompt += "Explica las dificultades y alternativas para una persona que entró legalmente con visa B2, estuvo SIN ESTATUS POR UN LARGO PERÍODO (AÑOS) y luego obtuvo TPS, que ahora quiere ajustar su estatus como beneficiario derivado de EB1.\n\n"
+                         "Para tu respuesta:\n"
+                         "1. Sé claro en que la sección 245(k) NO es aplicable porque SOLO perdona hasta 180 días sin estatus.\n"
+                         "2. Con un período tan largo sin estatus, el ajuste dentro de EE.UU. será difícil o imposible.\n"
+                         "3. Menciona alternativas como la sección 245(i), perdones por dificultad extrema, o procesamiento consular.\n"
+                         "4. Sé concreto sobre las dificultades pero presenta todas las opciones posibles.\n"
+                         "5. Enfatiza la importancia de consultar con un abogado para este caso complejo.\n\n";
+            } else {
+                prompt += "Explica si una persona que entró legalmente con visa B2, quedó sin estatus y luego obtuvo TPS, puede ajustar su estatus como beneficiario derivado de EB1.\n\n"
+                         "Para tu respuesta:\n"
+                         "1. La entrada legal con visa B2 es favorable porque la persona fue inspeccionada y admitida legalmente.\n"
+                         "2. El período sin estatus entre el vencimiento de la B2 y la obtención del TPS puede ser perdonado bajo sección 245(k) si fue menor a 180 días.\n"
+                         "3. TPS proporciona estatus legal temporal y autorización de trabajo, pero no resuelve automáticamente períodos previos sin estatus.\n"
+                         "4. Para beneficiarios derivados de EB1 aplican los mismos requisitos de admisibilidad.\n"
+                         "5. Es posible ajustar estatus si el período sin estatus fue menor a 180 días o califica para excepciones.\n\n";
+            }
+            
+            prompt += "Respuesta:";
+        } 
+        else {
+            // Original prompt para otras preguntas en español
+            prompt = "IMPORTANTE: RESPONDE ÚNICAMENTE EN ESPAÑOL.\n\n"
+                     "Eres un abogado experto en inmigración de EE.UU. Responde a la siguiente pregunta sobre inmigración:\n\n"
+                     "Pregunta: " + question + "\n\n"
+                     "Instrucciones específicas:\n"
+                     "1. RESPONDE SOLO EN ESPAÑOL de forma clara y detallada.\n"
+                     "2. Analiza punto por punto:\n"
+                     "   - Si la entrada legal con B2 y posterior TPS permite ajuste de estatus como beneficiario EB1\n"
+                     "   - Si aplica la sección 245(k) para períodos sin estatus\n"
+                     "   - Pros y contras de este caso específico\n"
+                     "3. Menciona específicamente la sección 245(k) y las excepciones aplicables.\n"
+                     "4. Resume al final con una respuesta clara (sí/no/quizás) y los pasos a seguir.\n\n"
+                     "Respuesta en español:";
+        }
+    } else {
+        // Prompt mejorado para preguntas en inglés
+        if (keywords.tps_eb1) {
+            
+            // Base del prompt
+            prompt = "As a U.S. immigration attorney, answer ONLY IN ENGLISH to this specific question:\n\n" + 
+                     question + "\n\n";
+            
+            // Instrucciones diferentes según si hay período largo o no
+            if (long_period) {
+                prompt += "Explain the challenges and alternatives for someone who entered legally with a B2 visa, was OUT OF STATUS FOR A LONG PERIOD (YEARS), then obtained TPS, and now wants to adjust status as an EB1 derivative beneficiary.\n\n"
+                         "For your answer:\n"
+                         "1. Be clear that section 245(k) is NOT applicable because it ONLY forgives up to 180 days out of status.\n"
+                         "2. With such a long period out of status, adjustment within the U.S. will be difficult or impossible.\n"
+                         "3. Mention alternatives like section 245(i), extreme hardship waivers, or consular processing.\n"
+                         "4. Be concrete about the challenges but present all possible options.\n"
+                         "5. Emphasize the importance of consulting with an attorney for this complex case.\n\n";
+            } else {
+                prompt += "Explain if someone who entered legally with a B2 visa, went out of status and then obtained TPS, can adjust their status as an EB1 derivative beneficiary.\n\n"
+                         "For your answer:\n"
+                         "1. Legal entry with a B2 visa is favorable because the person was inspected and legally admitted.\n"
+                         "2. The period without status between the B2 expiration and obtaining TPS can be forgiven under section 245(k) if less than 180 days.\n"
+                         "3. TPS provides temporary legal status and work authorization, but doesn't automatically resolve previous periods without status.\n"
+                         "4. For EB1 derivative beneficiaries, the same admissibility requirements apply.\n"
+                         "5. It's possible to adjust status if the period without status was less than 180 days or qualifies for exceptions.\n\n";
+            }
+            
+            prompt += "Response:";
+        } else {
+            // Original prompt para preguntas generales en inglés
+            prompt = "IMPORTANT: RESPOND ONLY IN ENGLISH.\n\n"
+                    "You are a U.S. immigration attorney. Answer the following immigration question:\n\n"
+                    "Question: " + question + "\n\n"
+                    "Specific instructions:\n"
+                    "1. RESPOND ONLY IN ENGLISH in a clear and detailed manner.\n"
+                    "2. Analyze point by point:\n"
+                    "   - If legal entry with B2 and subsequent TPS allows status adjustment as EB1 beneficiary\n"
+                    "   - If section 245(k) applies to out-of-status periods\n"
+                    "   - Pros and cons of this specific case\n"
+                    "3. Specifically mention section 245(k) and applicable exceptions.\n"
+                    "4. Summarize at the end with a clear answer (yes/no/maybe) and next steps.\n\n"
+                    "Response in English:";
+        }
+    }
+    
+    return prompt;
+}
+
+// Prompt más directo para reintentar cuando la respuesta llegó en otro idioma
+inline std::string build_retry_prompt(const std::string& question, const std::string& language) {
+    if (language == "es") {
+        return "RESPONDE EXCLUSIVAMENTE EN ESPAÑOL. ESTO ES CRÍTICO.\n\n"
+               "Pregunta sobre inmigración: " + question + "\n\n"
+               "TU RESPUESTA (SOLO EN ESPAÑOL):";
+    } else {
+        return "RESPOND EXCLUSIVELY IN ENGLISH. THIS IS CRITICAL.\n\n"
+               "Immigration question: " + question + "\n\n"
+               "YOUR ANSWER (ONLY IN ENGLISH):";
+    }
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <shared_mutex>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <algorithm>
+#include "tokenizer.h"
+#include "text_utils.h"
+
+// Resultado de una consulta a la caché semántica
+struct SemanticLookup {
+    std::string answer;      // Vacía si no hubo coincidencia
+    double similarity = 0.0; // Similitud de Jaccard estimada
+    bool exact = false;      // La pregunta normalizada era idéntica
+};
+
+struct SemanticCacheStats {
+    size_t entries = 0;
+    uint64_t hits = 0;
+    uint64_t near_hits = 0;
+    uint64_t misses = 0;
+};
+
+// Caché de respuestas por similitud de preguntas. Cada pregunta se resume en
+// una firma MinHash de sus palabras y trigramas de caracteres; las firmas se
+// reparten en bandas (LSH) para encontrar candidatas sin recorrer toda la
+// caché. Una paráfrasis reutiliza la respuesta si la similitud estimada
+// supera el umbral configurado y además nombra exactamente los mismos términos
+// decisivos: los términos de inmigración de scan_question_keywords y los
+// códigos con cifras (formularios, secciones, categorías de visa). Así "245(i)"
+// no responde a "245(k)", ni EB2 a EB3, ni I-130 a I-485, por mucho que el
+// resto de la pregunta coincida.
+class SemanticCache {
+public:
+    static constexpr size_t NUM_HASHES = 64;
+    static constexpr size_t BANDS = 16;
+    static constexpr size_t ROWS_PER_BAND = NUM_HASHES / BANDS;
+
+    using Signature = std::array<uint64_t, NUM_HASHES>;
+
+    explicit SemanticCache(double threshold = 0.6, size_t capacity = 4096)
+        : threshold_(threshold), capacity_(capacity == 0 ? 1 : capacity) {}
+
+    SemanticCache(const SemanticCache&) = delete;
+    SemanticCache& operator=(const SemanticCache&) = delete;
+
+    double threshold() const { return threshold_; }
+
+    // keywords: scan_question_keywords de la misma pregunta
+    SemanticLookup lookup(const TokenizedText& question, const QuestionKeywords& keywords,
+                          const std::string& language) {
+        SemanticLookup result;
+        Signature signature;
+        const std::string& normalized_question = question.normalized();
+        if (!compute_signature(question.tokens(), signature)) {
+            misses_++;
+            return result;
+        }
+        std::vector<std::string> codes;
+        numbered_codes(question.tokens(), codes);
+
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        std::unordered_set<uint32_t> seen;
+        const Entry* best = nullptr;
+
+        for (size_t band = 0; band < BANDS; ++band) {
+            auto it = buckets_[band].find(band_hash(signature, band));
+            if (it == buckets_[band].end()) continue;
+
+            for (uint32_t slot : it->second) {
+                if (!seen.insert(slot).second) continue;
+
+                const Entry& entry = entries_[slot];
+                if (entry.language != language || entry.immigration_terms != keywords.immigration_terms ||
+                    entry.codes != codes) {
+                    continue;
+                }
+
+                double similarity = estimate_similarity(signature, entry.signature);
+                if (entry.question == normalized_question) {
+                    similarity = 1.0;
+                }
+                if (similarity >= threshold_ && similarity > result.similarity) {
+                    result.similarity = similarity;
+                    best = &entry;
+                }
+            }
+        }
+
+        if (!best) {
+            misses_++;
+            return result;
+        }
+
+        result.answer = best->answer;
+        result.exact = best->question == normalized_question;
+        if (result.exact) {
+            hits_++;
+        } else {
+            near_hits_++;
+        }
+        return result;
+    }
+
+    void insert(const TokenizedText& question, const QuestionKeywords& keywords, const std::string& language,
+                const std::string& answer) {
+        Entry entry;
+        if (answer.empty() || !compute_signature(question.tokens(), entry.signature)) {
+            return;
+        }
+        entry.immigration_terms = keywords.immigration_terms;
+        numbered_codes(question.tokens(), entry.codes);
+        entry.question = question.normalized();
+        entry.language = language;
+        entry.answer = answer;
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+
+        // Reemplazo FIFO cuando la caché está llena
+        uint32_t slot;
+        if (entries_.size() < capacity_) {
+            slot = static_cast<uint32_t>(entries_.size());
+            entries_.push_back(Entry());
+        } else {
+            slot = static_cast<uint32_t>(next_slot_);
+            next_slot_ = (next_slot_ + 1) % capacity_;
+            unlink(slot);
+        }
+
+        entries_[slot] = std::move(entry);
+        for (size_t band = 0; band < BANDS; ++band) {
+            buckets_[band][band_hash(entries_[slot].signature, band)].push_back(slot);
+        }
+    }
+
+    SemanticCacheStats stats() const {
+        SemanticCacheStats stats;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            stats.entries = entries_.size();
+        }
+        stats.hits = hits_.load();
+        stats.near_hits = near_hits_.load();
+        stats.misses = misses_.load();
+        return stats;
+    }
+
+private:
+    struct Entry {
+        Signature signature{};
+        uint64_t immigration_terms = 0;   // Deben coincidir para reutilizar la respuesta
+        std::vector<std::string> codes;   // Ídem (ordenados)
+        std::string question;
+        std::string language;
+        std::string answer;
+    };
+
+    static uint64_t mix(uint64_t x) {
+        // splitmix64
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t hash_text(std::string_view text, uint64_t seed) {
+        uint64_t h = 0xCBF29CE484222325ull ^ seed;
+        for (unsigned char c : text) {
+            h ^= c;
+            h *= 0x100000001B3ull;
+        }
+        return h;
+    }
+
+    // Conjunto de rasgos: palabras completas y trigramas de caracteres de
+    // cada palabra (para acercar variantes como "solicito"/"solicitar")
+    static bool compute_signature(const std::vector<std::string_view>& words, Signature& signature) {
+        if (words.empty()) {
+            return false;
+        }
+
+        signature.fill(std::numeric_limits<uint64_t>::max());
+        auto add_feature = [&](uint64_t feature) {
+            for (size_t i = 0; i < NUM_HASHES; ++i) {
+                uint64_t h = mix(feature ^ (0x9E3779B97F4A7C15ull * (i + 1)));
+                if (h < signature[i]) {
+                    signature[i] = h;
+                }
+            }
+        };
+
+        for (std::string_view word : words) {
+            add_feature(hash_text(word, 1));
+            if (word.size() > 3) {
+                for (size_t i = 0; i + 3 <= word.size(); ++i) {
+                    add_feature(hash_text(word.substr(i, 3), 2));
+                }
+            }
+        }
+        return true;
+    }
+
+    // Códigos con cifras, ordenados y sin repetir. El tokenizador parte "245(i)",
+    // "i-130" o "h-1b" en varias palabras: una letra suelta junto a una palabra
+    // con cifras se une a ella ("245i", "i130", "h1b").
+    static void numbered_codes(const std::vector<std::string_view>& words, std::vector<std::string>& codes) {
+        auto is_letter = [](std::string_view word) {
+            return word.size() == 1 && word[0] >= 'a' && word[0] <= 'z';
+        };
+        codes.clear();
+        for (size_t i = 0; i < words.size(); ++i) {
+            if (words[i].find_first_of("0123456789") == std::string_view::npos) {
+                continue;
+            }
+            std::string code;
+            if (i > 0 && is_letter(words[i - 1])) {
+                code += words[i - 1];
+            }
+            code += words[i];
+            if (i + 1 < words.size() && is_letter(words[i + 1])) {
+                code += words[i + 1];
+            }
+            codes.push_back(std::move(code));
+        }
+        std::sort(codes.begin(), codes.end());
+        codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+    }
+
+    static uint64_t band_hash(const Signature& signature, size_t band) {
+        uint64_t h = band;
+        for (size_t r = 0; r < ROWS_PER_BAND; ++r) {
+            h = mix(h ^ signature[band * ROWS_PER_BAND + r]);
+        }
+        return h;
+    }
+
+    static double estimate_similarity(const Signature& a, const Signature& b) {
+        size_t same = 0;
+        for (size_t i = 0; i < NUM_HASHES; ++i) {
+            if (a[i] == b[i]) same++;
+        }
+        return static_cast<double>(same) / NUM_HASHES;
+    }
+
+    void unlink(uint32_t slot) {
+        for (size_t band = 0; band < BANDS; ++band) {
+            auto it = buckets_[band].find(band_hash(entries_[slot].signature, band));
+            if (it == buckets_[band].end()) continue;
+
+            auto& slots = it->second;
+            for (size_t i = 0; i < slots.size(); ++i) {
+                if (slots[i] == slot) {
+                    slots[i] = slots.back();
+                    slots.pop_back();
+                    break;
+                }
+            }
+            if (slots.empty()) {
+                buckets_[band].erase(it);
+            }
+        }
+    }
+
+    const double threshold_;
+    const size_t capacity_;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<Entry> entries_;
+    std::array<std::unordered_map<uint64_t, std::vector<uint32_t>>, BANDS> buckets_;
+    size_t next_slot_ = 0;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> near_hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
@@ -0,0 +1,101 @@
+// Pruebas de SemanticCache (semantic_cache.h). Se ejecuta con ctest.
+// Las preguntas que solo se diferencian en el término que decide la respuesta
+// legal (245(i) frente a 245(k), EB2 frente a EB3, I-130 frente a I-485...)
+// superan el umbral de similitud por MinHash, pero nunca deben compartir
+// respuesta; las paráfrasis con los mismos términos sí.
+#include <iostream>
+#include <string>
+#include <vector>
+#include "semantic_cache.h"
+
+static size_t g_checks = 0;
+static size_t g_failures = 0;
+
+struct QuestionPair {
+    const char* cached;
+    const char* asked;
+    const char* language;
+};
+
+static SemanticLookup lookup(SemanticCache& cache, const std::string& question, const std::string& language) {
+    TokenizedText query(question);
+    return cache.lookup(query, scan_question_keywords(query.normalized()), language);
+}
+
+static void insert(SemanticCache& cache, const std::string& question, const std::string& language,
+                   const std::string& answer) {
+    TokenizedText query(question);
+    cache.insert(query, scan_question_keywords(query.normalized()), language, answer);
+}
+
+// Con la configuración por defecto del motor (umbral 0.6)
+static void expect(const QuestionPair& pair, bool should_hit, const char* what) {
+    g_checks++;
+    SemanticCache cache;
+    insert(cache, pair.cached, pair.language, "respuesta guardada");
+    SemanticLookup result = lookup(cache, pair.asked, pair.language);
+    if (result.answer.empty() == should_hit) {
+        g_failures++;
+        std::cerr << "FALLO (" << what << ")\n"
+                  << "  guardada=\"" << pair.cached << "\"\n"
+                  << "  pregunta=\"" << pair.asked << "\"\n"
+                  << "  similitud=" << result.similarity << "\n";
+    }
+}
+
+int main() {
+    // Mismo texto salvo el término decisivo: la respuesta de una es incorrecta para la otra
+    const std::vector<QuestionPair> different_answers = {
+        {"¿Puedo ajustar estatus bajo la sección 245(i) si entré sin inspección?",
+         "¿Puedo ajustar estatus bajo la sección 245(k) si entré sin inspección?", "es"},
+        {"¿Puedo ajustar estatus bajo la sección 245 i si entré sin inspección?",
+         "¿Puedo ajustar estatus bajo la sección 245 k si entré sin inspección?", "es"},
+        {"¿Cuánto tarda la residencia por la categoría EB2 para profesionales con maestría?",
+         "¿Cuánto tarda la residencia por la categoría EB3 para profesionales con maestría?", "es"},
+        {"¿Cuánto tarda la residencia por la categoría EB-2 para profesionales?",
+         "¿Cuánto tarda la residencia por la categoría EB-3 para profesionales?", "es"},
+        {"¿Qué documentos necesito enviar con el formulario I-130 para mi esposo?",
+         "¿Qué documentos necesito enviar con el formulario I-485 para mi esposo?", "es"},
+        {"What documents do I need to file with form I-130 for my spouse?",
+         "What documents do I need to file with form I-485 for my spouse?", "en"},
+        {"How long does an H-1B visa transfer take to a new employer?",
+         "How long does an H-2B visa transfer take to a new employer?", "en"},
+        {"¿Cuánto cuesta renovar el permiso de trabajo con TPS este año?",
+         "¿Cuánto cuesta renovar el permiso de trabajo con DACA este año?", "es"},
+        {"¿Puedo pedir asilo si llevo más de un año en Estados Unidos?",
+         "¿Puedo pedir parole si llevo más de un año en Estados Unidos?", "es"},
+    };
+    for (const auto& pair : different_answers) {
+        expect(pair, false, "término decisivo distinto");
+    }
+
+    // Mismos términos decisivos: la paráfrasis reutiliza la respuesta
+    const std::vector<QuestionPair> same_answers = {
+        {"¿Puedo ajustar estatus bajo la sección 245(i) si entré sin inspección?",
+         "¿Puedo ajustar mi estatus bajo la sección 245(i) si entré sin inspección?", "es"},
+        {"¿Qué documentos necesito enviar con el formulario I-130 para mi esposo?",
+         "¿Qué documentos necesito enviar con el formulario I-130 para mi esposa?", "es"},
+        {"What documents do I need to file with form I-130 for my spouse?",
+         "Which documents do I need to file with form I-130 for my spouse?", "en"},
+        {"¿Cuánto tarda la residencia por la categoría EB2 para profesionales con maestría?",
+         "¿Cuánto tarda la residencia por la categoría EB2 para los profesionales con maestría?", "es"},
+    };
+    for (const auto& pair : same_answers) {
+        expect(pair, true, "paráfrasis con los mismos términos");
+    }
+
+    // Las mismas palabras con otra ortografía aciertan; en otro idioma, nunca
+    expect({"¿Cómo solicito asilo?", "como solicito ASILO", "es"}, true, "mismas palabras");
+    {
+        g_checks++;
+        SemanticCache cache;
+        insert(cache, "How do I apply for asylum?", "en", "respuesta guardada");
+        if (!lookup(cache, "How do I apply for asylum?", "es").answer.empty()) {
+            g_failures++;
+            std::cerr << "FALLO (otro idioma): se reutilizó una respuesta en inglés\n";
+        }
+    }
+
+    std::cout << "semantic_cache: " << g_checks << " comprobaciones, " << g_failures << " fallos\n";
+    return g_failures == 0 ? 0 : 1;
+}
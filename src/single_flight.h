@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+struct SingleFlightStats {
+    size_t in_flight = 0;       // Cálculos en curso
+    uint64_t leaders = 0;       // Llamadas que calcularon el resultado
+    uint64_t followers = 0;     // Llamadas que esperaron el de otra
+};
+
+// Deduplicación de cálculos simultáneos ("single-flight"): la primera llamada
+// con una clave calcula el resultado y las que llegan con la misma clave
+// mientras tanto esperan ese mismo resultado en lugar de repetir el trabajo.
+// La clave se olvida en cuanto el cálculo termina, así que no es una caché:
+// quien llega después vuelve a calcular (y normalmente acierta en la caché).
+template <typename Value>
+class SingleFlight {
+public:
+    // shared (opcional) indica si el resultado vino del cálculo de otra llamada
+    template <typename Compute>
+    Value run(const std::string& key, Compute&& compute, bool* shared = nullptr) {
+        std::promise<Value> promise;
+        std::shared_future<Value> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = calls_.find(key);
+            if (it != calls_.end()) {
+                pending = it->second;
+                followers_++;
+            } else {
+                calls_.emplace(key, promise.get_future().share());
+                leaders_++;
+            }
+        }
+        if (shared) *shared = pending.valid();
+        if (pending.valid()) {
+            return pending.get();
+        }
+
+        // Si el cálculo lanza, la excepción llega también a los que esperan
+        try {
+            Value value = compute();
+            forget(key);
+            promise.set_value(value);
+            return value;
+        } catch (...) {
+            forget(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    SingleFlightStats stats() const {
+        SingleFlightStats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats.in_flight = calls_.size();
+        }
+        stats.leaders = leaders_.load();
+        stats.followers = followers_.load();
+        return stats;
+    }
+
+private:
+    void forget(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        calls_.erase(key);
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<Value>> calls_;
+    std::atomic<uint64_t> leaders_{0};
+    std::atomic<uint64_t> followers_{0};
+};
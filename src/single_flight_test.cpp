@@ -0,0 +1,139 @@
+// Pruebas de SingleFlight (single_flight.h). Se ejecuta con ctest.
+// Las llamadas simultáneas con la misma clave comparten un único cálculo
+// (también si lanza una excepción); con otra clave, o una vez terminado el
+// cálculo, se vuelve a calcular.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include "single_flight.h"
+
+static size_t g_checks = 0;
+static size_t g_failures = 0;
+
+static void expect(bool condition, const std::string& what) {
+    g_checks++;
+    if (!condition) {
+        g_failures++;
+        std::cerr << "FALLO: " << what << "\n";
+    }
+}
+
+// Espera (como mucho unos segundos) a que `done` se cumpla
+template <typename Condition>
+static bool wait_for(Condition done) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+int main() {
+    constexpr size_t THREADS = 8;
+
+    // Misma clave a la vez: un líder calcula y el resto espera su resultado.
+    // El cálculo no termina hasta que todos los seguidores están esperando.
+    {
+        SingleFlight<std::string> flight;
+        std::atomic<int> computations{0};
+        std::atomic<bool> release{false};
+        std::vector<std::string> results(THREADS);
+        std::vector<char> shared(THREADS, 0);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < THREADS; ++i) {
+            threads.emplace_back([&, i] {
+                bool was_shared = false;
+                results[i] = flight.run("¿qué es el tps?", [&] {
+                    computations++;
+                    wait_for([&] { return release.load(); });
+                    return std::string("respuesta");
+                }, &was_shared);
+                shared[i] = was_shared;
+            });
+        }
+        expect(wait_for([&] { return flight.stats().followers == THREADS - 1; }), "los seguidores esperan al líder");
+        expect(flight.stats().in_flight == 1, "un único cálculo en curso");
+        release = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        expect(computations == 1, "se calcula una sola vez");
+        size_t shared_count = 0;
+        for (size_t i = 0; i < THREADS; ++i) {
+            expect(results[i] == "respuesta", "todos reciben el resultado " + std::to_string(i));
+            shared_count += shared[i] ? 1 : 0;
+        }
+        expect(shared_count == THREADS - 1, "todos salvo el líder reciben un resultado compartido");
+        SingleFlightStats stats = flight.stats();
+        expect(stats.leaders == 1 && stats.followers == THREADS - 1 && stats.in_flight == 0, "estadísticas");
+
+        // Terminado el cálculo la clave se olvida: no es una caché
+        bool was_shared = true;
+        std::string again = flight.run("¿qué es el tps?", [&] {
+            computations++;
+            return std::string("otra respuesta");
+        }, &was_shared);
+        expect(again == "otra respuesta" && !was_shared && computations == 2, "se recalcula al terminar");
+    }
+
+    // Claves distintas no se esperan entre sí
+    {
+        SingleFlight<int> flight;
+        std::atomic<bool> release{false};
+        int first = 0;
+        std::thread blocked([&] {
+            first = flight.run("a", [&] {
+                wait_for([&] { return release.load(); });
+                return 1;
+            });
+        });
+        expect(wait_for([&] { return flight.stats().in_flight == 1; }), "primer cálculo en curso");
+        bool was_shared = true;
+        const int second = flight.run("b", [] { return 2; }, &was_shared);
+        expect(second == 2 && !was_shared, "otra clave calcula sin esperar");
+        release = true;
+        blocked.join();
+        expect(first == 1, "el primer cálculo termina con su valor");
+    }
+
+    // Si el cálculo lanza, la excepción llega a todos y la clave se olvida
+    {
+        SingleFlight<int> flight;
+        std::atomic<bool> release{false};
+        std::atomic<int> errors{0};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < THREADS; ++i) {
+            threads.emplace_back([&] {
+                try {
+                    flight.run("falla", [&]() -> int {
+                        wait_for([&] { return release.load(); });
+                        throw std::runtime_error("Ollama no responde");
+                    });
+                } catch (const std::runtime_error& error) {
+                    if (std::string(error.what()) == "Ollama no responde") {
+                        errors++;
+                    }
+                }
+            });
+        }
+        expect(wait_for([&] { return flight.stats().followers == THREADS - 1; }), "los seguidores esperan al líder que falla");
+        release = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        expect(errors == static_cast<int>(THREADS), "la excepción llega a todas las llamadas");
+        expect(flight.stats().in_flight == 0, "la clave se olvida tras la excepción");
+        expect(flight.run("falla", [] { return 7; }) == 7, "se puede volver a calcular tras la excepción");
+    }
+
+    std::cout << "single_flight: " << g_checks << " comprobaciones, " << g_failures << " fallos\n";
+    return g_failures == 0 ? 0 : 1;
+}
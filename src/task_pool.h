@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+// Hilos de trabajo para tareas cortas que no deben correr en un hilo de E/S
+// (p. ej. la búsqueda en SQLite y en la base de conocimiento de
+// /chatbot/stream). La cola está acotada: si se llena, post() devuelve false
+// y quien llama responde con un error en vez de acumular retraso.
+class TaskPool {
+public:
+    explicit TaskPool(size_t capacity = 1024) : capacity_(capacity) {}
+    ~TaskPool() { stop(); }
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    void start(size_t workers) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!threads_.empty()) {
+            return;
+        }
+        stopping_ = false;
+        for (size_t i = 0; i < (workers == 0 ? 1 : workers); ++i) {
+            threads_.emplace_back(&TaskPool::run, this);
+        }
+    }
+
+    // Termina las tareas ya encoladas y detiene los hilos
+    void stop() {
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            threads.swap(threads_);
+        }
+        cv_.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    bool post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || threads_.empty() || tasks_.size() >= capacity_) {
+                return false;
+            }
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
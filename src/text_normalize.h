@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Normalización de texto UTF-8 para búsqueda: minúsculas y sin acentos en una
+// sola pasada. Las letras latinas U+00C0..U+00FF ("á", "Ñ", "ü"...) se pliegan
+// a su letra ASCII base; el resto de caracteres multibyte se copian intactos,
+// así que "¿", "¡" o un emoji nunca se corrompen. El resultado nunca es más
+// largo que la entrada y normalizar dos veces da lo mismo que una.
+namespace text_normalize_detail {
+
+struct Tables {
+    std::array<char, 128> ascii_lower{};
+    // Plegado de U+00C0..U+00FF, indexado por el segundo byte de 0xC3 0x80..0xBF.
+    // nullptr = copiar el carácter tal cual (× y ÷)
+    std::array<const char*, 64> latin1_fold{};
+
+    constexpr Tables() {
+        for (int c = 0; c < 128; ++c) {
+            ascii_lower[c] = static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        }
+
+        const char* const upper_half[32] = {
+            "a", "a", "a", "a", "a", "a", "ae", "c",    // À Á Â Ã Ä Å Æ Ç
+            "e", "e", "e", "e", "i", "i", "i", "i",     // È É Ê Ë Ì Í Î Ï
+            "d", "n", "o", "o", "o", "o", "o", nullptr, // Ð Ñ Ò Ó Ô Õ Ö ×
+            "o", "u", "u", "u", "u", "y", "th", "ss"    // Ø Ù Ú Û Ü Ý Þ ß
+        };
+        for (int i = 0; i < 32; ++i) {
+            latin1_fold[i] = upper_half[i];
+            latin1_fold[i + 32] = upper_half[i];
+        }
+        latin1_fold[0x37] = nullptr;  // ÷
+        latin1_fold[0x3E] = "th";     // þ
+        latin1_fold[0x3F] = "y";      // ÿ
+    }
+};
+
+inline constexpr Tables TABLES{};
+
+// Longitud de una secuencia UTF-8 según su primer byte (1 si no es válido)
+inline size_t sequence_length(unsigned char lead) {
+    if (lead >= 0xC2 && lead <= 0xDF) return 2;
+    if (lead >= 0xE0 && lead <= 0xEF) return 3;
+    if (lead >= 0xF0 && lead <= 0xF4) return 4;
+    return 1;
+}
+
+// Núcleo de normalize_into. Con UseSimd = false se omite el camino SSE2, de
+// modo que las pruebas pueden comparar ambos caminos con la misma entrada.
+template <bool UseSimd>
+inline void normalize(std::string_view text, std::string& out) {
+    out.resize(text.size());
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(text.data());
+    char* dst = out.data();
+    const size_t n = text.size();
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < n) {
+#if defined(__SSE2__)
+        if constexpr (UseSimd) {
+            // Camino rápido: bloques de 16 bytes ASCII, 'A'..'Z' -> 'a'..'z' de una vez
+            while (i + 16 <= n) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                if (_mm_movemask_epi8(chunk) != 0) {
+                    break;  // Hay algún byte no ASCII en el bloque
+                }
+                __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('A' - 1)),
+                                                 _mm_cmplt_epi8(chunk, _mm_set1_epi8('Z' + 1)));
+                chunk = _mm_add_epi8(chunk, _mm_and_si128(is_upper, _mm_set1_epi8('a' - 'A')));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + o), chunk);
+                i += 16;
+                o += 16;
+            }
+            if (i >= n) {
+                break;
+            }
+        }
+#endif
+        const unsigned char c = src[i];
+        if (c < 0x80) {
+            dst[o++] = TABLES.ascii_lower[c];
+            i++;
+            continue;
+        }
+
+        if (c == 0xC3 && i + 1 < n && (src[i + 1] & 0xC0) == 0x80) {
+            const char* folded = TABLES.latin1_fold[src[i + 1] - 0x80];
+            if (folded) {
+                // Como mucho dos letras por dos bytes de entrada
+                dst[o++] = folded[0];
+                if (folded[1]) {
+                    dst[o++] = folded[1];
+                }
+            } else {
+                dst[o++] = static_cast<char>(src[i]);
+                dst[o++] = static_cast<char>(src[i + 1]);
+            }
+            i += 2;
+            continue;
+        }
+
+        // Cualquier otro carácter: copiar la secuencia completa sin tocarla
+        // (solo los bytes de continuación, para no tragarse ASCII tras un
+        // byte inválido)
+        const size_t length = sequence_length(c);
+        dst[o++] = static_cast<char>(src[i++]);
+        for (size_t k = 1; k < length && i < n && (src[i] & 0xC0) == 0x80; ++k) {
+            dst[o++] = static_cast<char>(src[i++]);
+        }
+    }
+
+    out.resize(o);
+}
+
+} // namespace text_normalize_detail
+
+// Normalizar text en out (se reutiliza su capacidad, sin reservar memoria si
+// ya basta). out no puede apuntar a la misma memoria que text.
+inline void normalize_into(std::string_view text, std::string& out) {
+    text_normalize_detail::normalize<true>(text, out);
+}
+
+// Versión que devuelve una cadena nueva, para llamadas puntuales
+inline std::string normalize_text(std::string_view text) {
+    std::string result;
+    normalize_into(text, result);
+    return result;
+}
@@ -0,0 +1,250 @@
+// Pruebas de corrección de normalize_into (text_normalize.h) con las preguntas
+// reales de dataset/*.json y con casos límite de UTF-8. Se ejecuta con ctest:
+//   text_normalize_test <directorio del dataset>
+// Para cada texto comprueba que el camino SSE2 da lo mismo que el escalar, que
+// ambos coinciden con una implementación de referencia por puntos de código,
+// que normalizar dos veces no cambia nada y que el resultado nunca crece.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <nlohmann/json.hpp>
+#include "text_normalize.h"
+
+using json = nlohmann::json;
+
+static size_t g_checks = 0;
+static size_t g_failures = 0;
+
+static std::string escape(const std::string& text) {
+    std::string out;
+    for (unsigned char c : text) {
+        if (c >= 0x20 && c < 0x7F) {
+            out += static_cast<char>(c);
+        } else {
+            const char* hex = "0123456789ABCDEF";
+            out += "\\x";
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+        }
+    }
+    return out;
+}
+
+static void fail(const std::string& what, const std::string& input, const std::string& got, const std::string& expected) {
+    if (++g_failures <= 20) {
+        std::cerr << "FALLO (" << what << ") entrada=\"" << escape(input) << "\"\n"
+                  << "  obtenido=\"" << escape(got) << "\"\n"
+                  << "  esperado=\"" << escape(expected) << "\"\n";
+    }
+}
+
+// Plegado esperado de U+00C0..U+00FF, escrito a partir de las propias letras y
+// no de las tablas de text_normalize.h
+static const std::map<uint32_t, std::string>& reference_fold() {
+    static const std::map<uint32_t, std::string> fold = [] {
+        const std::pair<const char*, const char*> groups[] = {
+            {"ÀÁÂÃÄÅàáâãäå", "a"}, {"Ææ", "ae"}, {"Çç", "c"}, {"ÈÉÊËèéêë", "e"},
+            {"ÌÍÎÏìíîï", "i"}, {"Ðð", "d"}, {"Ññ", "n"}, {"ÒÓÔÕÖØòóôõöø", "o"},
+            {"ÙÚÛÜùúûü", "u"}, {"Ýýÿ", "y"}, {"Þþ", "th"}, {"ß", "ss"},
+        };
+        std::map<uint32_t, std::string> result;
+        for (const auto& [letters, base] : groups) {
+            std::string text = letters;
+            for (size_t i = 0; i + 1 < text.size(); i += 2) {
+                uint32_t code_point = ((static_cast<unsigned char>(text[i]) & 0x1F) << 6) |
+                                      (static_cast<unsigned char>(text[i + 1]) & 0x3F);
+                result[code_point] = base;
+            }
+        }
+        return result;
+    }();
+    return fold;
+}
+
+// Referencia: ASCII a minúsculas; U+00C0..U+00FF bien formados se pliegan (× y
+// ÷ se conservan); cualquier otro byte se copia sin tocar
+static std::string reference_normalize(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            out += static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+            continue;
+        }
+        if (c == 0xC3 && i + 1 < text.size() && (static_cast<unsigned char>(text[i + 1]) & 0xC0) == 0x80) {
+            uint32_t code_point = 0xC0 | (static_cast<unsigned char>(text[i + 1]) & 0x3F);
+            auto it = reference_fold().find(code_point);
+            out += it != reference_fold().end() ? it->second : text.substr(i, 2);
+            ++i;
+            continue;
+        }
+        out += static_cast<char>(c);
+    }
+    return out;
+}
+
+static bool valid_utf8(const std::string& text) {
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        size_t length = c < 0x80 ? 1 : (c >= 0xC2 && c <= 0xDF) ? 2 : (c >= 0xE0 && c <= 0xEF) ? 3 : (c >= 0xF0 && c <= 0xF4) ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            return false;
+        }
+        for (size_t k = 1; k < length; ++k) {
+            if ((static_cast<unsigned char>(text[i + k]) & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+// Todas las propiedades para un texto; expected vacío = usar la referencia
+static void check(const std::string& input, const std::string* expected = nullptr) {
+    g_checks++;
+    std::string simd;
+    std::string scalar;
+    text_normalize_detail::normalize<true>(input, simd);
+    text_normalize_detail::normalize<false>(input, scalar);
+    const std::string reference = reference_normalize(input);
+
+    if (simd != scalar) {
+        fail("SSE2 frente a escalar", input, simd, scalar);
+    }
+    if (scalar != reference) {
+        fail("escalar frente a referencia", input, scalar, reference);
+    }
+    if (expected && simd != *expected) {
+        fail("resultado conocido", input, simd, *expected);
+    }
+    if (simd.size() > input.size()) {
+        fail("el resultado crece", input, simd, reference);
+    }
+    if (normalize_text(simd) != simd) {
+        fail("no es idempotente", input, normalize_text(simd), simd);
+    }
+    if (valid_utf8(input) && !valid_utf8(simd)) {
+        fail("UTF-8 válido produce UTF-8 no válido", input, simd, reference);
+    }
+
+    // La salida reutiliza la capacidad de out: restos de una cadena más larga no deben quedar
+    std::string reused(input.size() + 64, 'X');
+    normalize_into(input, reused);
+    if (reused != simd) {
+        fail("reutilizando la salida", input, reused, simd);
+    }
+}
+
+static void check_known(const std::string& input, const std::string& expected) {
+    check(input, &expected);
+}
+
+// Casos límite: secuencias multibyte con 0xE1/0xE9 (que en Latin-1 son "á" y
+// "é"), UTF-8 truncado o inválido, y bloques de 16 bytes que cortan caracteres
+static void check_edge_cases() {
+    check_known("ÁÉÍÓÚÑÜ áéíóúñü", "aeiounu aeiounu");
+    check_known("¿Qué es el TPS?", "¿que es el tps?");
+    check_known("Æsop Þorn STRAßE", "aesop thorn strasse");
+    check_known("2×3÷1", "2×3÷1");
+    check_known("ḁ Ḁ ḿ", "ḁ Ḁ ḿ");                 // U+1E01, U+1E00, U+1E3F: E1 B8/B9 xx
+    check_known("\xE9\x9B\xBB\xE8\xA9\xB1 é", "\xE9\x9B\xBB\xE8\xA9\xB1 e"); // 電話: E9 9B BB
+    check_known("\xE1\xBA\xBE\xC3\x89", "\xE1\xBA\xBE" "e");   // Ế seguido de É
+    check_known("caf\xE9 ma\xF1" "ana", "caf\xE9 ma\xF1" "ana"); // Latin-1 crudo: sin tocar
+    check_known("\xE1" "ABC", "\xE1" "abc");                     // Prefijo sin continuación: el ASCII se pliega
+    check_known("\xE9\x80" "ABC", "\xE9\x80" "abc");             // Secuencia de 3 bytes truncada
+    check_known("\xC3", "\xC3");                                 // 0xC3 al final
+    check_known("\xC3" "A", "\xC3" "a");                         // 0xC3 sin continuación
+    check_known("\xC3\xE1\xB8\x81", "\xC3\xE1\xB8\x81");          // 0xC3 seguido de otro inicio
+    check_known("\xC3\xC3\x89", "\xC3" "e");
+    check_known("\x80\xBF" "A\xC3\x81", "\x80\xBF" "aa");         // Continuaciones sueltas
+    check_known("\xF0\x9F\x98\x80 HOLA", "\xF0\x9F\x98\x80 hola"); // Emoji
+    check_known("\xF0\x9F\x98" "A", "\xF0\x9F\x98" "a");          // Emoji truncado
+    check_known("\xF8\xFF\xFE" "Z", "\xF8\xFF\xFE" "z");          // Bytes nunca válidos
+    check_known("", "");
+
+    // Un carácter multibyte en cada posición de un bloque de 16 bytes, y al borde del final
+    const std::vector<std::string> specials = {"Á", "é", "\xE1\xB8\x81", "\xE9\x9B\xBB", "\xF0\x9F\x98\x80",
+                                               "\xC3", "\xE1", "\xE9\x80", "×"};
+    for (const auto& special : specials) {
+        for (size_t before = 0; before <= 33; ++before) {
+            for (size_t after : {0, 1, 15, 16, 17}) {
+                check(std::string(before, 'Q') + special + std::string(after, 'W'));
+            }
+        }
+    }
+
+    // Todos los pares de bytes 0x80..0xFF detrás de ASCII, dentro y fuera del camino rápido
+    for (int a = 0x80; a <= 0xFF; ++a) {
+        for (int b = 0; b <= 0xFF; b += 3) {
+            std::string pair{static_cast<char>(a), static_cast<char>(b)};
+            check("AB" + pair);
+            check("ABCDEFGHIJKLMNOP" + pair + "QRSTUVWXYZABCDEF");
+        }
+    }
+}
+
+// Preguntas del dataset: enteras, desplazadas respecto a los bloques de 16
+// bytes y cortadas en cada byte (lo que deja UTF-8 truncado)
+static size_t check_dataset(const std::string& dataset_dir) {
+    size_t questions = 0;
+    for (const char* name : {"nolivos_immigration_ai_extended.json", "nolivos_immigration_qa.json"}) {
+        std::ifstream file(dataset_dir + "/" + name);
+        if (!file.is_open()) {
+            std::cerr << "No se pudo abrir " << dataset_dir << "/" << name << "\n";
+            g_failures++;
+            continue;
+        }
+        json data = json::parse(file, nullptr, false);
+        if (!data.is_object()) {
+            std::cerr << "JSON no válido: " << dataset_dir << "/" << name << "\n";
+            g_failures++;
+            continue;
+        }
+        for (const auto& [category, entries] : data.items()) {
+            if (!entries.is_array()) {
+                continue;
+            }
+            for (const auto& entry : entries) {
+                if (!entry.is_object() || !entry.contains("question") || !entry["question"].is_string()) {
+                    continue;
+                }
+                const std::string question = entry["question"];
+                questions++;
+                for (size_t shift = 0; shift < 16; ++shift) {
+                    check(std::string(shift, 'X') + question);
+                }
+                for (size_t cut = 0; cut < question.size(); ++cut) {
+                    check(question.substr(0, cut));
+                    check(question.substr(cut));
+                }
+            }
+        }
+    }
+    if (questions == 0) {
+        std::cerr << "No se encontraron preguntas en " << dataset_dir << "\n";
+        g_failures++;
+    }
+    return questions;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " <directorio del dataset>\n";
+        return 2;
+    }
+
+    check_edge_cases();
+    size_t questions = check_dataset(argv[1]);
+
+#if defined(__SSE2__)
+    const char* simd = "SSE2";
+#else
+    const char* simd = "sin SSE2: solo el camino escalar";
+#endif
+    std::cout << "text_normalize: " << questions << " preguntas, " << g_checks << " comprobaciones (" << simd
+              << "), " << g_failures << " fallos\n";
+    return g_failures == 0 ? 0 : 1;
+}
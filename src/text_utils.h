@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iterator>
+#include <cstdint>
+#include "keyword_matcher.h"
+#include "keyword_responses.h"
+#include "text_normalize.h"
+#include "tokenizer.h"
+#include "language_id.h"
+
+// Utilidades de texto compartidas por el servidor y el cliente de línea de
+// comandos: detección de idioma, normalización y clasificación de preguntas.
+
+// Detectar el idioma de un texto (simplificado a español/inglés)
+inline std::string detect_language(const std::string& text) {
+    return guess_language(TokenizedText(text)).code;
+}
+
+// Clasificación de una pregunta por palabras clave. Las cuatro tablas (respuestas
+// por palabra clave, términos de inmigración para la complejidad, período largo
+// sin estatus y caso TPS a EB1) forman un único autómata de Aho-Corasick cuyas
+// palabras clave llevan la tabla a la que pertenecen, así que la pregunta se
+// recorre una sola vez y de esa pasada salen el enrutado, la complejidad y la
+// respuesta de respaldo.
+struct QuestionKeywords {
+    long keyword_response = KeywordMatcher::NO_MATCH; // Primera entrada de keyword_response_table() presente
+    uint64_t immigration_terms = 0;                   // Un bit por término de inmigración presente
+    bool long_period = false;                         // Período largo sin estatus
+    bool tps_eb1 = false;                             // Menciona b2, tps y eb1 (ajuste de TPS a EB1)
+
+    size_t immigration_term_count() const { return static_cast<size_t>(__builtin_popcountll(immigration_terms)); }
+};
+
+namespace text_utils_detail {
+
+// Términos específicos de inmigración: dos o más hacen compleja la pregunta
+inline constexpr std::string_view IMMIGRATION_KEYWORDS[] = {
+    "tps", "eb1", "eb2", "eb3", "ajust", "estatus", "status", "green card", "deportacion",
+    "asilo", "visa", "i-485", "i-130", "i-140", "waiver", "perdon", "inadmisible",
+    "overstay", "daca", "vawa", "u visa", "t visa", "245(i)", "245(k)", "asylum",
+    "citizenship", "ciudadania", "naturalizacion", "naturalization", "parole",
+    "adjustment", "removal", "deportation", "appeal", "apelacion", "h1b", "h2a", "h2b",
+    "refugee", "refugiado", "credible fear", "miedo creible", "priority date", "fecha prioritaria"
+};
+static_assert(std::size(IMMIGRATION_KEYWORDS) <= 64, "immigration_terms es una máscara de 64 bits");
+
+inline constexpr std::string_view LONG_PERIOD_KEYWORDS[] = {
+    "3 ano", "tres ano", "mas de 180", "anos sin estatus", "anos sin status",
+    "largo periodo", "largo tiempo", "mucho tiempo"
+};
+
+// El caso TPS a EB1 exige las tres
+inline constexpr std::string_view TPS_EB1_KEYWORDS[] = {"b2", "tps", "eb1"};
+
+enum class KeywordTable : uint8_t { RESPONSE, IMMIGRATION, LONG_PERIOD, TPS_EB1 };
+
+struct TaggedKeyword {
+    KeywordTable table;
+    uint32_t index;     // Posición dentro de su tabla
+};
+
+struct QuestionMatcher {
+    KeywordMatcher matcher;
+    std::vector<TaggedKeyword> tags;   // Por id de palabra clave del autómata
+
+    QuestionMatcher() {
+        // Las respuestas van primero: su id en el autómata es su posición en la tabla
+        auto add = [this](std::string_view keyword, KeywordTable table, size_t index) {
+            matcher.add(keyword);
+            tags.push_back({table, static_cast<uint32_t>(index)});
+        };
+        const auto& responses = keyword_response_table();
+        for (size_t i = 0; i < responses.size(); ++i) {
+            add(normalize_text(responses[i].first), KeywordTable::RESPONSE, i);
+        }
+        for (size_t i = 0; i < std::size(IMMIGRATION_KEYWORDS); ++i) {
+            add(IMMIGRATION_KEYWORDS[i], KeywordTable::IMMIGRATION, i);
+        }
+        for (size_t i = 0; i < std::size(LONG_PERIOD_KEYWORDS); ++i) {
+            add(LONG_PERIOD_KEYWORDS[i], KeywordTable::LONG_PERIOD, i);
+        }
+        for (size_t i = 0; i < std::size(TPS_EB1_KEYWORDS); ++i) {
+            add(TPS_EB1_KEYWORDS[i], KeywordTable::TPS_EB1, i);
+        }
+        matcher.build();
+    }
+};
+
+inline const QuestionMatcher& question_matcher() {
+    static const QuestionMatcher matcher;
+    return matcher;
+}
+
+} // namespace text_utils_detail
+
+// Una pasada del autómata compartido sobre la pregunta normalizada
+inline QuestionKeywords scan_question_keywords(std::string_view normalized_question) {
+    using text_utils_detail::KeywordTable;
+    const auto& question_matcher = text_utils_detail::question_matcher();
+    QuestionKeywords keywords;
+    uint32_t tps_eb1_seen = 0;
+    question_matcher.matcher.scan(normalized_question, [&](const KeywordMatch& match) {
+        const auto& tag = question_matcher.tags[match.keyword_id];
+        switch (tag.table) {
+            case KeywordTable::RESPONSE:
+                if (keywords.keyword_response == KeywordMatcher::NO_MATCH ||
+                    static_cast<long>(tag.index) < keywords.keyword_response) {
+                    keywords.keyword_response = static_cast<long>(tag.index);
+                }
+                break;
+            case KeywordTable::IMMIGRATION:
+                keywords.immigration_terms |= uint64_t{1} << tag.index;
+                break;
+            case KeywordTable::LONG_PERIOD:
+                keywords.long_period = true;
+                break;
+            case KeywordTable::TPS_EB1:
+                tps_eb1_seen |= 1u << tag.index;
+                break;
+        }
+        return true;
+    });
+    keywords.tps_eb1 = tps_eb1_seen == (1u << std::size(text_utils_detail::TPS_EB1_KEYWORDS)) - 1;
+    return keywords;
+}
+
+// Detectar si hay un período largo sin estatus
+inline bool has_long_period_without_status(const std::string& normalized_question) {
+    return scan_question_keywords(normalized_question).long_period;
+}
+
+// Detectar si una pregunta es compleja y requiere el modelo avanzado: al menos 2
+// términos específicos de inmigración o una pregunta larga
+inline bool is_complex_question(const TokenizedText& question, const QuestionKeywords& keywords) {
+    return keywords.immigration_term_count() >= 2 || question.source_length() > 100;
+}
+
+inline bool is_complex_question(const TokenizedText& question) {
+    return is_complex_question(question, scan_question_keywords(question.normalized()));
+}
+
+inline bool is_complex_question(const std::string& question) {
+    return is_complex_question(TokenizedText(question));
+}
+
+// Respuesta por palabras clave para una pregunta normalizada
+inline std::string generate_response(const std::string& normalized_question) {
+    return keyword_response(scan_question_keywords(normalized_question).keyword_response);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include "text_normalize.h"
+
+// Tokenizador compartido por la detección de idioma, el índice de la base de
+// conocimiento y la caché semántica. Las palabras son vistas (string_view)
+// sobre el texto original, así que recorrerlas no reserva memoria.
+//
+// Cualquier byte ASCII que no sea alfanumérico es un separador; los bytes
+// UTF-8 (>= 0x80) forman parte de la palabra salvo los signos de apertura
+// ¿ y ¡.
+namespace tokenizer_detail {
+
+struct WordBytes {
+    std::array<bool, 256> is_word{};
+
+    constexpr WordBytes() {
+        for (int c = 0; c < 256; ++c) {
+            is_word[c] = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                         (c >= 'A' && c <= 'Z') || c >= 0x80;
+        }
+    }
+};
+
+inline constexpr WordBytes WORD_BYTES{};
+
+} // namespace tokenizer_detail
+
+// Llama a on_token(std::string_view) por cada palabra del texto
+template <typename Fn>
+inline void for_each_token(std::string_view text, Fn&& on_token) {
+    const size_t n = text.size();
+    size_t start = 0;
+    size_t i = 0;
+
+    while (i < n) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        const bool opening_mark = c == 0xC2 && i + 1 < n &&
+            (static_cast<unsigned char>(text[i + 1]) == 0xBF ||
+             static_cast<unsigned char>(text[i + 1]) == 0xA1);
+
+        if (!opening_mark && tokenizer_detail::WORD_BYTES.is_word[c]) {
+            ++i;
+            continue;
+        }
+
+        if (i > start) {
+            on_token(text.substr(start, i - start));
+        }
+        i += opening_mark ? 2 : 1;
+        start = i;
+    }
+
+    if (n > start) {
+        on_token(text.substr(start));
+    }
+}
+
+// Añade a out las palabras del texto (out conserva su capacidad entre llamadas)
+inline void tokenize_into(std::string_view text, std::vector<std::string_view>& out) {
+    out.clear();
+    for_each_token(text, [&](std::string_view word) {
+        out.push_back(word);
+    });
+}
+
+// Pregunta normalizada y separada en palabras una sola vez por petición; la
+// detección de idioma, la búsqueda y la caché semántica trabajan sobre el
+// mismo resultado. Las palabras apuntan a normalized(), por eso no se copia.
+class TokenizedText {
+public:
+    explicit TokenizedText(std::string_view text) : source_length_(text.size()) {
+        normalize_into(text, normalized_);
+        tokenize_into(normalized_, tokens_);
+    }
+
+    TokenizedText(const TokenizedText&) = delete;
+    TokenizedText& operator=(const TokenizedText&) = delete;
+
+    const std::string& normalized() const { return normalized_; }
+    const std::vector<std::string_view>& tokens() const { return tokens_; }
+    bool empty() const { return tokens_.empty(); }
+
+    // Longitud en bytes del texto original, antes de normalizar
+    size_t source_length() const { return source_length_; }
+
+private:
+    std::string normalized_;
+    std::vector<std::string_view> tokens_;
+    size_t source_length_;
+};